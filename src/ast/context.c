@@ -1,6 +1,7 @@
 #include "src/ast/context.h"
 #include "src/ast/source_internal.h"
 #include "src/support/arena.h"
+#include "src/support/fnv1a.h"
 #include "src/support/hash_map.h"
 #include "src/support/malloc.h"
 
@@ -11,12 +12,117 @@ static HashMapConfig string_set_config = HASH_SET_CONFIG(
     AstString, AstString_hash_generic, AstString_equal_generic
 );
 
+/* Hash of a type's fields. Component types are interned already, so they
+ * are hashed and compared by identity. */
+static uint32_t type_hash(Type const* type) {
+    uint32_t hash;
+
+    hash = fnv1a_add_8(fnv1a_start(), type->kind);
+
+    switch (type->kind) {
+    case TypeKind_Simple:
+        return fnv1a_add_8(hash, ((SimpleType const*)type)->kind);
+
+    case TypeKind_Function: {
+        Type const* return_type;
+        return_type = ((FunctionType const*)type)->return_type;
+        return fnv1a_add(hash, &return_type, sizeof(return_type));
+    }
+    }
+
+    assert(0 && "unreachable");
+    return 0;
+}
+
+static int type_fields_equal(Type const* left, Type const* right) {
+    if (left->kind != right->kind) {
+        return false;
+    }
+
+    switch (left->kind) {
+    case TypeKind_Simple:
+        return ((SimpleType const*)left)->kind
+            == ((SimpleType const*)right)->kind;
+
+    case TypeKind_Function:
+        return ((FunctionType const*)left)->return_type
+            == ((FunctionType const*)right)->return_type;
+    }
+
+    assert(0 && "unreachable");
+    return false;
+}
+
+static uint32_t type_hash_generic(void const* item) {
+    return type_hash(*(Type const* const*)item);
+}
+
+static int type_equal_generic(void const* left, void const* right) {
+    return type_fields_equal(
+        *(Type const* const*)left, *(Type const* const*)right
+    );
+}
+
+static HashMapConfig type_set_config = HASH_SET_CONFIG(
+    Type*, type_hash_generic, type_equal_generic
+);
+
+/* Kind and payload of a constant value. Component values are interned
+ * already, so they are compared by ExprId. */
+typedef struct ValueKey {
+    ExprKind kind;
+    /* SimpleTypeKind, or the ExprId of a function type's return type. */
+    uint32_t operand;
+    BigInt integer;
+} ValueKey;
+
+static uint32_t value_key_hash_generic(void const* item) {
+    ValueKey const* key;
+    uint32_t hash;
+
+    key = item;
+    hash = fnv1a_add_8(fnv1a_start(), key->kind);
+
+    if (key->kind == ExprKind_IntLiteral) {
+        return fnv1a_add_32(hash, BigInt_hash(key->integer));
+    }
+    return fnv1a_add_32(hash, key->operand);
+}
+
+static int value_key_equal_generic(void const* left, void const* right) {
+    ValueKey const* left_key;
+    ValueKey const* right_key;
+
+    left_key = left;
+    right_key = right;
+
+    if (left_key->kind != right_key->kind) {
+        return false;
+    }
+    if (left_key->kind == ExprKind_IntLiteral) {
+        return BigInt_compare(left_key->integer, right_key->integer) == 0;
+    }
+    return left_key->operand == right_key->operand;
+}
+
+static HashMapConfig value_map_config = HASH_MAP_CONFIG(
+    ValueKey, ExprId, value_key_hash_generic, value_key_equal_generic
+);
+
 struct AstContext {
     Arena arena;
 
     /* Set[AstString] */
     HashMap string_set;
 
+    /* Set[Type*] */
+    HashMap type_set;
+
+    /* Map[ValueKey, ExprId] of constant values */
+    HashMap value_map;
+
+    AstNodes nodes;
+
     /** ArrayList[SourceFile*] */
     SourceFile const** files_data;
     size_t files_size;
@@ -24,9 +130,102 @@ struct AstContext {
 
     /* Cached types */
     SimpleType* simple_types[SimpleTypeKind_COUNT];
-    SimpleTypeExpr* simple_type_exprs[SimpleTypeKind_COUNT];
+    ExprId simple_type_exprs[SimpleTypeKind_COUNT];
 };
 
+/* Get the interned copy of `type`, which is `size` bytes long, making one
+ * if there is none. */
+static Type* intern_type(AstContext* ast, Type const* type, size_t size) {
+    Type** key;
+    int inserted;
+
+    HashMap_get_or_insert(
+        &ast->type_set, &type_set_config, &type, &inserted, (void**)&key, NULL
+    );
+
+    if (inserted) {
+        /* Replace the borrowed type with a copy owned by the context. */
+        Type* copy;
+        copy = AstContext_allocate(ast, size);
+        memcpy(copy, type, size);
+        *key = copy;
+    }
+
+    return *key;
+}
+
+/* Get the expression holding the value described by `key`, making one if
+ * there is none. */
+static ExprId intern_value(AstContext* ast, ValueKey const* key) {
+    ExprId* value;
+    int inserted;
+
+    HashMap_get_or_insert(
+        &ast->value_map,
+        &value_map_config,
+        key,
+        &inserted,
+        NULL,
+        (void**)&value
+    );
+
+    if (inserted) {
+        /* Making a node does not touch the map, so `value` stays valid. */
+        switch (key->kind) {
+        case ExprKind_IntLiteral:
+            *value = IntLiteralExpr_new(ast, key->integer);
+            break;
+
+        case ExprKind_SimpleType:
+            *value = SimpleTypeExpr_new(ast, key->operand);
+            break;
+
+        case ExprKind_FunctionType:
+            *value = FunctionTypeExpr_new(ast, key->operand);
+            break;
+
+        default:
+            assert(0 && "not a constant value");
+        }
+    }
+
+    return *value;
+}
+
+static void value_key_init(ValueKey* key, ExprKind kind) {
+    key->kind = kind;
+    key->operand = 0;
+    key->integer = BigInt_from_int(NULL, 0);
+}
+
+static void add_simple_types(AstContext* ast) {
+    int i;
+    for (i = 0; i < SimpleTypeKind_COUNT; i += 1) {
+        SimpleType type;
+        ValueKey key;
+
+        type.base.kind = TypeKind_Simple;
+        type.kind = i;
+        ast->simple_types[i] = (SimpleType*)intern_type(
+            ast, &type.base, sizeof(type)
+        );
+
+        value_key_init(&key, ExprKind_SimpleType);
+        key.operand = i;
+        ast->simple_type_exprs[i] = intern_value(ast, &key);
+    }
+}
+
+static void free_files(AstContext* ast) {
+    size_t i;
+    for (i = 0; i < ast->files_size; i += 1) {
+        SourceFile const* source;
+        source = ast->files_data[i];
+        SystemFile_unload_all(source->data, source->size, source->is_mapped);
+        xfree(source->line_starts);
+    }
+}
+
 AstContext* AstContext_new(void) {
     AstContext* ast;
 
@@ -34,64 +233,101 @@ AstContext* AstContext_new(void) {
 
     Arena_init(&ast->arena);
     HashMap_init(&ast->string_set, &string_set_config);
+    HashMap_init(&ast->type_set, &type_set_config);
+    HashMap_init(&ast->value_map, &value_map_config);
+    AstNodes_init(&ast->nodes);
     ast->files_data  = NULL;
     ast->files_size = 0;
     ast->files_capacity = 0;
 
-    /* Construct simple types. */
-    {
-        int i;
-        for (i = 0; i < SimpleTypeKind_COUNT; i += 1) {
-            ast->simple_types[i] = SimpleType_new(ast, i);
-            ast->simple_type_exprs[i] = SimpleTypeExpr_new(ast, i);
-        }
-    }
+    add_simple_types(ast);
 
     return ast;
 }
 
 void AstContext_delete(AstContext* ast) {
-    size_t i;
-    for (i = 0; i < ast->files_size; i += 1) {
-        xfree((void*)ast->files_data[i]->data);
-    }
+    free_files(ast);
     xfree(ast->files_data);
     HashMap_destroy(&ast->string_set);
+    HashMap_destroy(&ast->type_set);
+    HashMap_destroy(&ast->value_map);
+    AstNodes_destroy(&ast->nodes);
     Arena_destroy(&ast->arena);
     xfree(ast);
 }
 
+void AstContext_reset(AstContext* ast) {
+    free_files(ast);
+    ast->files_size = 0;
+    HashMap_reset(&ast->string_set);
+    HashMap_reset(&ast->type_set);
+    HashMap_reset(&ast->value_map);
+    AstNodes_reset(&ast->nodes);
+    Arena_reset(&ast->arena);
+
+    add_simple_types(ast);
+}
+
 AstString AstContext_add_string(AstContext* ast, StringRef value) {
     AstString item;
-    uint32_t id;
-
     AstString_init(&item, value);
+    return AstContext_add_hashed_string(ast, item);
+}
 
-    /* TODO: add HashMap API that avoids this double lookup */
+AstString AstContext_add_hashed_string(AstContext* ast, AstString string) {
+    AstString* key;
+    int inserted;
+    uint32_t id;
 
-    id = HashMap_get_id_by_key(&ast->string_set, &string_set_config, &item);
+    id = HashMap_get_or_insert(
+        &ast->string_set,
+        &string_set_config,
+        &string,
+        &inserted,
+        (void**)&key,
+        NULL
+    );
 
-    if (id == 0) {
+    if (inserted) {
+        /* Replace the borrowed data with a copy owned by the context. */
         uint8_t* copy;
-        copy = AstContext_allocate(ast, value.size);
-        memcpy(copy, value.data, value.size);
-        item.value.data = copy;
-        item.value.size = value.size;
-        HashMap_set(&ast->string_set, &string_set_config, &item, NULL);
-        return item;
-    } else {
-        AstString const* key;
-        key = HashMap_get_key_by_id(&ast->string_set, &string_set_config, id);
-        return *key;
+        copy = AstContext_allocate(ast, string.value.size);
+        memcpy(copy, string.value.data, string.value.size);
+        key->value.data = copy;
+        key->symbol = id;
     }
+
+    return *key;
+}
+
+AstString AstContext_symbol_string(AstContext const* ast, Symbol symbol) {
+    return *(AstString const*)HashMap_get_key_by_id(
+        &ast->string_set, &string_set_config, symbol
+    );
+}
+
+size_t AstContext_symbol_count(AstContext const* ast) {
+    return ast->string_set.entries_count;
 }
 
 void* AstContext_allocate(AstContext* ast, size_t size) {
     return Arena_allocate(&ast->arena, size);
 }
 
+Arena* AstContext_arena(AstContext* ast) {
+    return &ast->arena;
+}
+
+AstNodes* AstContext_nodes(AstContext* ast) {
+    return &ast->nodes;
+}
+
 static SourceFile const* add_file(
-    AstContext* ast, StringRef path, void const* data, size_t size
+    AstContext* ast,
+    StringRef path,
+    void const* data,
+    size_t size,
+    int is_mapped
 ) {
     SourceFile* source;
 
@@ -99,6 +335,11 @@ static SourceFile const* add_file(
     source->path = AstContext_add_string(ast, path);
     source->data = data;
     source->size = size;
+    source->is_mapped = is_mapped;
+    source->line_starts = NULL;
+    source->line_count = 0;
+    /* Built now rather than on first lookup, so lookups only read. */
+    SourceFile_build_line_starts(source);
 
     ast->files_data = ensure_array_capacity(
         sizeof(SourceFile*),
@@ -120,13 +361,14 @@ SystemIoError AstContext_source_from_file(
     SourceFile const** out_source
 ) {
     SystemIoError res;
-    void* data;
+    void const* data;
     size_t size;
+    int is_mapped;
 
-    res = SystemFile_read_all(file, &data, &size);
+    res = SystemFile_load_all(file, &data, &size, &is_mapped);
 
     if (res == SystemIoError_Success) {
-        *out_source = add_file(ast, path, data, size);
+        *out_source = add_file(ast, path, data, size, is_mapped);
     }
 
     return res;
@@ -144,7 +386,33 @@ SourceFile const* AstContext_source_from_bytes(
     memcpy(copy, data, size);
     copy[size] = 0;
 
-    return add_file(ast, path, copy, size);
+    return add_file(ast, path, copy, size, false);
+}
+
+SourceFile const* AstContext_source_from_edit(
+    AstContext* ast, SourceFile const* source, SourceEdit const* edit
+) {
+    char* data;
+    size_t size;
+    size_t suffix;
+
+    assert(edit->offset <= source->size);
+    assert(edit->removed_size <= source->size - edit->offset);
+
+    suffix = source->size - edit->offset - edit->removed_size;
+    size = edit->offset + edit->text.size + suffix;
+
+    data = xmalloc(size + 1);
+    memcpy(data, source->data, edit->offset);
+    memcpy(data + edit->offset, edit->text.data, edit->text.size);
+    memcpy(
+        data + edit->offset + edit->text.size,
+        source->data + edit->offset + edit->removed_size,
+        suffix
+    );
+    data[size] = 0;
+
+    return add_file(ast, source->path.value, data, size, false);
 }
 
 SimpleType* AstContext_simple_type(AstContext* ast, SimpleTypeKind kind) {
@@ -153,9 +421,28 @@ SimpleType* AstContext_simple_type(AstContext* ast, SimpleTypeKind kind) {
     return ast->simple_types[kind];
 }
 
-SimpleTypeExpr* AstContext_simple_type_expr(
-    AstContext* ast, SimpleTypeKind kind
-) {
+FunctionType* AstContext_function_type(AstContext* ast, Type* return_type) {
+    FunctionType type;
+    type.base.kind = TypeKind_Function;
+    type.return_type = return_type;
+    return (FunctionType*)intern_type(ast, &type.base, sizeof(type));
+}
+
+ExprId AstContext_int_value(AstContext* ast, BigInt value) {
+    ValueKey key;
+    value_key_init(&key, ExprKind_IntLiteral);
+    key.integer = value;
+    return intern_value(ast, &key);
+}
+
+ExprId AstContext_function_type_value(AstContext* ast, ExprId return_type) {
+    ValueKey key;
+    value_key_init(&key, ExprKind_FunctionType);
+    key.operand = return_type;
+    return intern_value(ast, &key);
+}
+
+ExprId AstContext_simple_type_expr(AstContext* ast, SimpleTypeKind kind) {
     assert(kind >= 0);
     assert(kind < SimpleTypeKind_COUNT);
     return ast->simple_type_exprs[kind];
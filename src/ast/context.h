@@ -4,8 +4,16 @@
 #include "src/ast/source.h"
 #include "src/ast/string.h"
 #include "src/ast/nodes.h"
+#include "src/support/arena.h"
 #include "src/support/io.h"
 
+/*
+ * Owner of sources, interned strings, types, constant values, and nodes.
+ * Adding to a context is not thread-safe, but any number of threads may read
+ * from it while none is adding, and may annotate distinct expressions after
+ * `AstNodes_reserve_expr_infos`. Sources are indexed by line as they are
+ * added, so `SourceFile_get_pos` only reads.
+ */
 typedef struct AstContext AstContext;
 
 /** Create AstContext instance. */
@@ -14,6 +22,10 @@ AstContext* AstContext_new(void);
 /** Deinitialize and deallocate AstContext. */
 void AstContext_delete(AstContext* ast);
 
+/** Remove all sources, strings, and nodes, but keep the memory for reuse.
+ * Everything previously obtained from the context is invalidated. */
+void AstContext_reset(AstContext* ast);
+
 /** Read a file and add it to the context. */
 SystemIoError AstContext_source_from_file(
     AstContext* ast,
@@ -30,16 +42,53 @@ SourceFile const* AstContext_source_from_bytes(
     size_t size
 );
 
+/** Create a copy of `source` with `edit` applied, under the same path. */
+SourceFile const* AstContext_source_from_edit(
+    AstContext* ast, SourceFile const* source, SourceEdit const* edit
+);
+
 /** Create an interned string. */
 AstString AstContext_add_string(AstContext* ast, StringRef value);
 
+/** Intern a string whose hash is already computed. The data is copied if
+ * the string is new. */
+AstString AstContext_add_hashed_string(AstContext* ast, AstString string);
+
+/** Interned string with the given symbol. */
+AstString AstContext_symbol_string(AstContext const* ast, Symbol symbol);
+
+/** Number of interned strings, which is also the largest symbol. */
+size_t AstContext_symbol_count(AstContext const* ast);
+
 /** Allocate data owned by the context. */
 void* AstContext_allocate(AstContext* ast, size_t size);
 
-/** Get a cached SimpleType instance. */
+/** Arena owning data allocated by the context, such as big integers. */
+Arena* AstContext_arena(AstContext* ast);
+
+/** Syntax tree nodes created in the context. */
+AstNodes* AstContext_nodes(AstContext* ast);
+
+/** Get the interned SimpleType instance. */
 SimpleType* AstContext_simple_type(AstContext* ast, SimpleTypeKind kind);
 
-/** Get a cached SimpleTypeExpr instance. */
-SimpleTypeExpr* AstContext_simple_type_expr(AstContext* ast, SimpleTypeKind kind);
+/** Get the interned FunctionType with the given signature. */
+FunctionType* AstContext_function_type(AstContext* ast, Type* return_type);
+
+/*
+ * Constant values are interned expressions: each distinct value has a single
+ * node, so equal values have equal ExprIds.
+ */
+
+/** Get the interned SimpleTypeExpr node. */
+ExprId AstContext_simple_type_expr(AstContext* ast, SimpleTypeKind kind);
+
+/** Get the interned IntLiteralExpr with the given value. The value must live
+ * as long as the context. */
+ExprId AstContext_int_value(AstContext* ast, BigInt value);
+
+/** Get the interned FunctionTypeExpr whose return type is the interned value
+ * `return_type`. */
+ExprId AstContext_function_type_value(AstContext* ast, ExprId return_type);
 
 #endif
@@ -1,16 +1,20 @@
 #include "src/ast/dump.h"
 
-static void Item_dump_internal(Item const* item, Writer* writer, int indent);
+static void Item_dump_internal(
+    AstNodes const* nodes, ItemId item, Writer* writer, int indent
+);
 
-void Item_dump(Item const* item, Writer* writer) {
-    Item_dump_internal(item, writer, 0);
+void Item_dump(AstNodes const* nodes, ItemId item, Writer* writer) {
+    Item_dump_internal(nodes, item, writer, 0);
     Writer_format(writer, "\n");
 }
 
-static void Expr_dump_internal(Expr const* expr, Writer* writer, int indent);
+static void Expr_dump_internal(
+    AstNodes const* nodes, ExprId expr, Writer* writer, int indent
+);
 
-void Expr_dump(Expr const* expr, Writer* writer) {
-    Expr_dump_internal(expr, writer, 0);
+void Expr_dump(AstNodes const* nodes, ExprId expr, Writer* writer) {
+    Expr_dump_internal(nodes, expr, writer, 0);
     Writer_format(writer, "\n");
 }
 
@@ -21,24 +25,28 @@ void Type_dump(Type const* type, Writer* writer) {
     Writer_format(writer, "\n");
 }
 
-#define X(name)                                                    \
-    static void name##Item_dump_internal(                          \
-        name##Item const* item, Writer* writer, int indent         \
-    );                                                             \
-    void name##Item_dump(name##Item const* item, Writer* writer) { \
-        name##Item_dump_internal(item, writer, 0);                 \
-        Writer_format(writer, "\n");                               \
+#define X(name)                                                        \
+    static void name##Item_dump_internal(                              \
+        AstNodes const* nodes, ItemId item, Writer* writer, int indent \
+    );                                                                 \
+    void name##Item_dump(                                              \
+        AstNodes const* nodes, ItemId item, Writer* writer             \
+    ) {                                                                \
+        name##Item_dump_internal(nodes, item, writer, 0);              \
+        Writer_format(writer, "\n");                                   \
     }
 ITEM_KIND_LIST(X)
 #undef X
 
-#define X(name)                                                    \
-    static void name##Expr_dump_internal(                          \
-        name##Expr const* expr, Writer* writer, int indent         \
-    );                                                             \
-    void name##Expr_dump(name##Expr const* expr, Writer* writer) { \
-        name##Expr_dump_internal(expr, writer, 0);                 \
-        Writer_format(writer, "\n");                               \
+#define X(name)                                                        \
+    static void name##Expr_dump_internal(                              \
+        AstNodes const* nodes, ExprId expr, Writer* writer, int indent \
+    );                                                                 \
+    void name##Expr_dump(                                              \
+        AstNodes const* nodes, ExprId expr, Writer* writer             \
+    ) {                                                                \
+        name##Expr_dump_internal(nodes, expr, writer, 0);              \
+        Writer_format(writer, "\n");                                   \
     }
 EXPR_KIND_LIST(X)
 #undef X
@@ -54,26 +62,30 @@ EXPR_KIND_LIST(X)
 TYPE_KIND_LIST(X)
 #undef X
 
-static void Item_dump_internal(Item const* item, Writer* writer, int indent) {
-    switch (item->kind) {
-    #define X(name)                                                            \
-        case ItemKind_##name:                                                  \
-            name##Item_dump_internal((name##Item const*)item, writer, indent); \
+static void Item_dump_internal(
+    AstNodes const* nodes, ItemId item, Writer* writer, int indent
+) {
+    switch (Item_kind(nodes, item)) {
+    #define X(name)                                                \
+        case ItemKind_##name:                                      \
+            name##Item_dump_internal(nodes, item, writer, indent); \
             break;
             ITEM_KIND_LIST(X)
     #undef X
     }
 }
 
-static void Expr_dump_internal(Expr const* expr, Writer* writer, int indent) {
-    if (expr->const_eval != NULL) {
-        expr = expr->const_eval;
+static void Expr_dump_internal(
+    AstNodes const* nodes, ExprId expr, Writer* writer, int indent
+) {
+    if (Expr_info(nodes, expr)->const_eval != 0) {
+        expr = Expr_info(nodes, expr)->const_eval;
     }
 
-    switch (expr->kind) {
-    #define X(name)                                                            \
-        case ExprKind_##name:                                                  \
-            name##Expr_dump_internal((name##Expr const*)expr, writer, indent); \
+    switch (Expr_kind(nodes, expr)) {
+    #define X(name)                                                \
+        case ExprKind_##name:                                      \
+            name##Expr_dump_internal(nodes, expr, writer, indent); \
             break;
             EXPR_KIND_LIST(X)
     #undef X
@@ -103,8 +115,12 @@ static void write_indent(Writer* writer, int indent) {
  */
 
 static void FunctionItem_dump_internal(
-    FunctionItem const* item, Writer* writer, int indent
+    AstNodes const* nodes, ItemId id, Writer* writer, int indent
 ) {
+    FunctionItem const* item;
+
+    item = FunctionItem_get(nodes, id);
+
     Writer_format(writer, "FunctionItem(\n");
     indent += 1;
 
@@ -115,12 +131,12 @@ static void FunctionItem_dump_internal(
 
     write_indent(writer, indent);
     Writer_format(writer, "type = ");
-    FunctionTypeExpr_dump_internal(item->type, writer, indent);
+    FunctionTypeExpr_dump_internal(nodes, item->type, writer, indent);
     Writer_format(writer, ",\n");
 
     write_indent(writer, indent);
     Writer_format(writer, "body = ");
-    Expr_dump_internal(item->body, writer, indent);
+    Expr_dump_internal(nodes, item->body, writer, indent);
     Writer_format(writer, ",\n");
 
     indent -= 1;
@@ -133,34 +149,40 @@ static void FunctionItem_dump_internal(
  */
 
 static void IntLiteralExpr_dump_internal(
-    IntLiteralExpr const* expr, Writer* writer, int indent
+    AstNodes const* nodes, ExprId expr, Writer* writer, int indent
 ) {
+    Type const* type;
+
     Writer_format(writer, "IntLiteralExpr(value = ");
-    BigInt_write(writer, expr->value, 10);
+    BigInt_write(writer, IntLiteralExpr_value(nodes, expr), 10);
 
-    if (expr->base.type != NULL) {
+    type = Expr_info(nodes, expr)->type;
+    if (type != NULL) {
         Writer_format(writer, ", type = ");
-        Type_dump_internal(expr->base.type, writer, indent);
+        Type_dump_internal(type, writer, indent);
     }
 
     Writer_format(writer, ")");
 }
 
 static void ReturnExpr_dump_internal(
-    ReturnExpr const* item, Writer* writer, int indent
+    AstNodes const* nodes, ExprId expr, Writer* writer, int indent
 ) {
+    Type const* type;
+
     Writer_format(writer, "ReturnExpr(\n");
     indent += 1;
 
     write_indent(writer, indent);
     Writer_format(writer, "value = ");
-    Expr_dump_internal(item->value, writer, indent);
+    Expr_dump_internal(nodes, ReturnExpr_value(nodes, expr), writer, indent);
     Writer_format(writer, ",\n");
 
-    if (item->base.type != NULL) {
+    type = Expr_info(nodes, expr)->type;
+    if (type != NULL) {
         write_indent(writer, indent);
         Writer_format(writer, "type = ");
-        Type_dump_internal(item->base.type, writer, indent);
+        Type_dump_internal(type, writer, indent);
         Writer_format(writer, ",\n");
     }
 
@@ -170,26 +192,28 @@ static void ReturnExpr_dump_internal(
 }
 
 static void NameExpr_dump_internal(
-    NameExpr const* expr, Writer* writer, int indent
+    AstNodes const* nodes, ExprId expr, Writer* writer, int indent
 ) {
-    (void)indent; /* unused */
+    Type const* type;
+
     Writer_format(writer, "NameExpr(value = \"");
-    Writer_write_str(writer, expr->name.value);
+    Writer_write_str(writer, NameExpr_name(nodes, expr).value);
     Writer_format(writer, "\"");
 
-    if (expr->base.type != NULL) {
+    type = Expr_info(nodes, expr)->type;
+    if (type != NULL) {
         Writer_format(writer, ", type = ");
-        Type_dump_internal(expr->base.type, writer, indent);
+        Type_dump_internal(type, writer, indent);
     }
 
     Writer_format(writer, ")");
 }
 
 static void SimpleTypeExpr_dump_internal(
-    SimpleTypeExpr const* expr, Writer* writer, int indent
+    AstNodes const* nodes, ExprId expr, Writer* writer, int indent
 ) {
     (void)indent; /* unused */
-    switch (expr->kind) {
+    switch (SimpleTypeExpr_kind(nodes, expr)) {
     #define X(name)                                   \
         case SimpleTypeKind_##name:                   \
             Writer_format(writer, "%sExpr()", #name); \
@@ -200,20 +224,25 @@ static void SimpleTypeExpr_dump_internal(
 }
 
 static void FunctionTypeExpr_dump_internal(
-    FunctionTypeExpr const* expr, Writer* writer, int indent
+    AstNodes const* nodes, ExprId expr, Writer* writer, int indent
 ) {
+    Type const* type;
+
     Writer_format(writer, "FunctionTypeExpr(\n");
     indent += 1;
 
     write_indent(writer, indent);
     Writer_format(writer, "return_type = ");
-    Expr_dump_internal(expr->return_type, writer, indent);
+    Expr_dump_internal(
+        nodes, FunctionTypeExpr_return_type(nodes, expr), writer, indent
+    );
     Writer_format(writer, ",\n");
 
-    if (expr->base.type != NULL) {
+    type = Expr_info(nodes, expr)->type;
+    if (type != NULL) {
         write_indent(writer, indent);
         Writer_format(writer, "type = ");
-        Type_dump_internal(expr->base.type, writer, indent);
+        Type_dump_internal(type, writer, indent);
         Writer_format(writer, ",\n");
     }
 
@@ -3,15 +3,17 @@
 
 #include "src/ast/nodes.h"
 
-void Item_dump(Item const* expr, Writer* writer);
-void Expr_dump(Expr const* expr, Writer* writer);
+void Item_dump(AstNodes const* nodes, ItemId item, Writer* writer);
+void Expr_dump(AstNodes const* nodes, ExprId expr, Writer* writer);
 void Type_dump(Type const* type, Writer* writer);
 
-#define X(name) void name##Item_dump(name##Item const* expr, Writer* writer);
+#define X(name) \
+    void name##Item_dump(AstNodes const* nodes, ItemId item, Writer* writer);
 ITEM_KIND_LIST(X)
 #undef X
 
-#define X(name) void name##Expr_dump(name##Expr const* expr, Writer* writer);
+#define X(name) \
+    void name##Expr_dump(AstNodes const* nodes, ExprId expr, Writer* writer);
 EXPR_KIND_LIST(X)
 #undef X
 
@@ -1,118 +1,260 @@
 #include "src/ast/nodes.h"
 #include "src/ast/context.h"
+#include "src/support/malloc.h"
 
 #include <assert.h>
+#include <string.h>
+
+/*
+ * Nodes
+ */
+
+void AstNodes_init(AstNodes* nodes) {
+    nodes->expr_kinds = NULL;
+    nodes->expr_operands = NULL;
+    nodes->exprs_capacity = 0;
+    nodes->expr_infos = NULL;
+    nodes->expr_infos_capacity = 0;
+    nodes->integers = NULL;
+    nodes->integers_capacity = 0;
+    nodes->names = NULL;
+    nodes->names_capacity = 0;
+    nodes->item_kinds = NULL;
+    nodes->item_operands = NULL;
+    nodes->items_capacity = 0;
+    nodes->function_items = NULL;
+    nodes->function_items_capacity = 0;
+    nodes->module_items = NULL;
+    nodes->module_items_capacity = 0;
+
+    AstNodes_reset(nodes);
+}
+
+void AstNodes_destroy(AstNodes* nodes) {
+    xfree(nodes->expr_kinds);
+    xfree(nodes->expr_operands);
+    xfree(nodes->expr_infos);
+    xfree(nodes->integers);
+    xfree(nodes->names);
+    xfree(nodes->item_kinds);
+    xfree(nodes->item_operands);
+    xfree(nodes->function_items);
+    xfree(nodes->module_items);
+}
+
+void AstNodes_reset(AstNodes* nodes) {
+    /* Index 0 of the node arrays is reserved for no node. */
+    nodes->exprs_size = 1;
+    nodes->items_size = 1;
+    nodes->expr_infos_size = 0;
+    nodes->integers_size = 0;
+    nodes->names_size = 0;
+    nodes->function_items_size = 0;
+    nodes->module_items_size = 0;
+}
+
+/* Zero-fill `expr_infos` up to `size`. */
+static void grow_expr_infos(AstNodes* nodes, size_t size) {
+    if (size > nodes->expr_infos_size) {
+        nodes->expr_infos = ensure_array_capacity(
+            sizeof(ExprInfo),
+            nodes->expr_infos,
+            &nodes->expr_infos_size,
+            &nodes->expr_infos_capacity,
+            size - nodes->expr_infos_size
+        );
+        memset(
+            nodes->expr_infos + nodes->expr_infos_size,
+            0,
+            (size - nodes->expr_infos_size) * sizeof(ExprInfo)
+        );
+        nodes->expr_infos_size = size;
+    }
+}
+
+ExprInfo* AstNodes_expr_info(AstNodes* nodes, ExprId expr) {
+    assert(expr != 0);
+    assert(expr < nodes->exprs_size);
+
+    grow_expr_infos(nodes, expr + 1);
+    return &nodes->expr_infos[expr];
+}
+
+void AstNodes_reserve_expr_infos(AstNodes* nodes) {
+    grow_expr_infos(nodes, nodes->exprs_size);
+}
+
+/* Capacity to grow parallel node arrays to. 1.5x growth rate. */
+static size_t next_capacity(size_t capacity) {
+    /* FIXME: overflow */
+    return capacity == 0 ? 16 : capacity + capacity / 2;
+}
+
+static ExprId add_expr(AstContext* ast, ExprKind kind, uint32_t operand) {
+    AstNodes* nodes;
+    ExprId expr;
+
+    nodes = AstContext_nodes(ast);
+
+    /* The reserved index 0 may not be allocated yet. */
+    if (nodes->exprs_size >= nodes->exprs_capacity) {
+        nodes->exprs_capacity = next_capacity(nodes->exprs_capacity);
+        nodes->expr_kinds = xreallocarray(
+            nodes->expr_kinds, nodes->exprs_capacity, sizeof(uint8_t)
+        );
+        nodes->expr_operands = xreallocarray(
+            nodes->expr_operands, nodes->exprs_capacity, sizeof(uint32_t)
+        );
+    }
+
+    expr = nodes->exprs_size;
+    nodes->expr_kinds[expr] = kind;
+    nodes->expr_operands[expr] = operand;
+    nodes->exprs_size += 1;
+
+    return expr;
+}
+
+static ItemId add_item(AstContext* ast, ItemKind kind, uint32_t operand) {
+    AstNodes* nodes;
+    ItemId item;
+
+    nodes = AstContext_nodes(ast);
+
+    if (nodes->items_size >= nodes->items_capacity) {
+        nodes->items_capacity = next_capacity(nodes->items_capacity);
+        nodes->item_kinds = xreallocarray(
+            nodes->item_kinds, nodes->items_capacity, sizeof(uint8_t)
+        );
+        nodes->item_operands = xreallocarray(
+            nodes->item_operands, nodes->items_capacity, sizeof(uint32_t)
+        );
+    }
+
+    item = nodes->items_size;
+    nodes->item_kinds[item] = kind;
+    nodes->item_operands[item] = operand;
+    nodes->items_size += 1;
+
+    return item;
+}
 
 /*
  * Items
  */
 
-FunctionItem* FunctionItem_new(
+ItemId FunctionItem_new(
     AstContext* ast,
     AstString name,
-    FunctionTypeExpr* type,
-    Expr* body
+    ExprId type,
+    ExprId body
 ) {
+    AstNodes* nodes;
     FunctionItem* item;
-    item = AstContext_allocate(ast, sizeof(FunctionItem));
+
+    nodes = AstContext_nodes(ast);
+    nodes->function_items = ensure_array_capacity(
+        sizeof(FunctionItem),
+        nodes->function_items,
+        &nodes->function_items_size,
+        &nodes->function_items_capacity,
+        1
+    );
+
+    item = &nodes->function_items[nodes->function_items_size];
     item->name = name;
-    item->body = body;
     item->type = type;
-    return item;
+    item->body = body;
+    nodes->function_items_size += 1;
+
+    return add_item(
+        ast, ItemKind_Function, nodes->function_items_size - 1
+    );
 }
 
 /*
- * Expressions
+ * Modules
  */
 
-IntLiteralExpr* IntLiteralExpr_new(AstContext* ast, BigInt value) {
-    IntLiteralExpr* expr;
-    expr = AstContext_allocate(ast, sizeof(IntLiteralExpr));
-    expr->base.kind = ExprKind_IntLiteral;
-    expr->base.type = NULL;
-    expr->base.const_eval = NULL;
-    expr->base.as_type = NULL;
-    expr->value = value;
-    return expr;
+void Module_init(AstContext* ast, Module* module) {
+    module->items_start = AstContext_nodes(ast)->module_items_size;
+    module->items_size = 0;
 }
 
-ReturnExpr* ReturnExpr_new(AstContext* ast, Expr* value) {
-    ReturnExpr* expr;
-    expr = AstContext_allocate(ast, sizeof(ReturnExpr));
-    expr->base.kind = ExprKind_Return;
-    expr->base.type = NULL;
-    expr->base.const_eval = NULL;
-    expr->base.as_type = NULL;
-    expr->value = value;
-    return expr;
-}
+void Module_add_item(AstContext* ast, Module* module, ItemId item) {
+    AstNodes* nodes;
 
-NameExpr* NameExpr_new(AstContext* ast, AstString name) {
-    NameExpr* expr;
-    expr = AstContext_allocate(ast, sizeof(NameExpr));
-    expr->base.kind = ExprKind_Name;
-    expr->base.type = NULL;
-    expr->base.const_eval = NULL;
-    expr->base.as_type = NULL;
-    expr->name = name;
-    return expr;
-}
+    nodes = AstContext_nodes(ast);
+    assert(
+        module->items_start + module->items_size == nodes->module_items_size
+    );
 
-SimpleTypeExpr* SimpleTypeExpr_new(struct AstContext* ast, SimpleTypeKind kind) {
-    SimpleTypeExpr* expr;
-    expr = AstContext_allocate(ast, sizeof(SimpleTypeExpr));
-    expr->base.kind = ExprKind_SimpleType;
-    expr->base.type = NULL;
-    expr->base.const_eval = NULL;
-    expr->base.as_type = NULL;
-    expr->kind = kind;
-    return expr;
-}
-
-FunctionTypeExpr* FunctionTypeExpr_new(
-    struct AstContext* ast, Expr* return_type
-) {
-    FunctionTypeExpr* expr;
-    expr = AstContext_allocate(ast, sizeof(FunctionTypeExpr));
-    expr->base.kind = ExprKind_FunctionType;
-    expr->base.type = NULL;
-    expr->base.const_eval = NULL;
-    expr->base.as_type = NULL;
-    expr->return_type = return_type;
-    return expr;
+    nodes->module_items = ensure_array_capacity(
+        sizeof(ItemId),
+        nodes->module_items,
+        &nodes->module_items_size,
+        &nodes->module_items_capacity,
+        1
+    );
+    nodes->module_items[nodes->module_items_size] = item;
+    nodes->module_items_size += 1;
+    module->items_size += 1;
 }
 
 /*
- * Types
+ * Expressions
  */
 
-int Type_equal(Type const* left, Type const* right) {
-    if (left == right) {
-        return true;
-    }
+ExprId IntLiteralExpr_new(AstContext* ast, BigInt value) {
+    AstNodes* nodes;
 
-    if (left->kind != right->kind) {
-        return false;
-    }
+    nodes = AstContext_nodes(ast);
+    nodes->integers = ensure_array_capacity(
+        sizeof(BigInt),
+        nodes->integers,
+        &nodes->integers_size,
+        &nodes->integers_capacity,
+        1
+    );
+    nodes->integers[nodes->integers_size] = value;
+    nodes->integers_size += 1;
 
-    switch (left->kind) {
-    case TypeKind_Simple:
-        return ((SimpleType const*)left)->kind
-            == ((SimpleType const*)right)->kind;
+    return add_expr(ast, ExprKind_IntLiteral, nodes->integers_size - 1);
+}
 
-    case TypeKind_Function: {
-        FunctionType const* left_func;
-        FunctionType const* right_func;
-        left_func = (FunctionType const*)left;
-        right_func = (FunctionType const*)right;
+ExprId ReturnExpr_new(AstContext* ast, ExprId value) {
+    return add_expr(ast, ExprKind_Return, value);
+}
 
-        return Type_equal(left_func->return_type, right_func->return_type);
-    }
-    }
+ExprId NameExpr_new(AstContext* ast, AstString name) {
+    AstNodes* nodes;
 
-    assert(0 && "unreachable");
+    nodes = AstContext_nodes(ast);
+    nodes->names = ensure_array_capacity(
+        sizeof(AstString),
+        nodes->names,
+        &nodes->names_size,
+        &nodes->names_capacity,
+        1
+    );
+    nodes->names[nodes->names_size] = name;
+    nodes->names_size += 1;
+
+    return add_expr(ast, ExprKind_Name, nodes->names_size - 1);
 }
 
+ExprId SimpleTypeExpr_new(AstContext* ast, SimpleTypeKind kind) {
+    return add_expr(ast, ExprKind_SimpleType, kind);
+}
+
+ExprId FunctionTypeExpr_new(AstContext* ast, ExprId return_type) {
+    return add_expr(ast, ExprKind_FunctionType, return_type);
+}
+
+/*
+ * Types
+ */
+
 StringRef Type_name(Type const* type) {
     /* FIXME: full name should be cached in the type */
     switch (type->kind) {
@@ -136,19 +278,3 @@ StringRef Type_name(Type const* type) {
 
     assert(0 && "unreachable");
 }
-
-SimpleType* SimpleType_new(AstContext* ast, SimpleTypeKind kind) {
-    SimpleType* type;
-    type = AstContext_allocate(ast, sizeof(SimpleType));
-    type->base.kind = TypeKind_Simple;
-    type->kind = kind;
-    return type;
-}
-
-FunctionType* FunctionType_new(AstContext* ast, Type* return_type) {
-    FunctionType* type;
-    type = AstContext_allocate(ast, sizeof(FunctionType));
-    type->base.kind = TypeKind_Function;
-    type->return_type = return_type;
-    return type;
-}
@@ -54,103 +54,216 @@ typedef enum SimpleTypeKind {
     SimpleTypeKind_COUNT ATTR_UNUSED
 } SimpleTypeKind;
 
-typedef struct Item Item;
-typedef struct Expr Expr;
+/** Index of an item in AstNodes. 0 is no item. */
+typedef uint32_t ItemId;
+
+/** Index of an expression in AstNodes. 0 is no expression. */
+typedef uint32_t ExprId;
+
 typedef struct Type Type;
 
 #define X(name) typedef struct name##Item name##Item;
 ITEM_KIND_LIST(X)
 #undef X
 
-#define X(name) typedef struct name##Expr name##Expr;
-EXPR_KIND_LIST(X)
-#undef X
-
 #define X(name) typedef struct name##Type name##Type;
 TYPE_KIND_LIST(X)
 #undef X
 
-struct Item {
-    ItemKind kind;
+struct Type {
+    TypeKind kind;
 };
 
-struct Expr {
-    ExprKind kind;
+/*
+ * Nodes
+ */
 
-    /* null before type checking */
+/** Semantic annotations of an expression. Null before type checking. */
+typedef struct ExprInfo {
     Type* type;
-    Expr* const_eval;
     Type* as_type;
-};
-
-struct Type {
-    TypeKind kind;
-};
+    /* Interned constant value. Equal values have equal ids. */
+    ExprId const_eval;
+} ExprInfo;
+
+/**
+ * Syntax tree of an AstContext, stored as parallel arrays indexed by ItemId
+ * and ExprId, so a node takes five bytes plus any payload. Children are
+ * referred to by index rather than pointer.
+ *
+ * The operand of an expression depends on its kind: a child ExprId, a
+ * SimpleTypeKind, or an index into `integers` or `names`. Items have their
+ * fields in a per-kind array.
+ *
+ * Semantic annotations live in `expr_infos`, a side table that only covers
+ * the expressions annotated so far.
+ */
+typedef struct AstNodes {
+    /* ExprKind of each expression. */
+    uint8_t* expr_kinds;
+    uint32_t* expr_operands;
+    size_t exprs_size;
+    size_t exprs_capacity;
+
+    ExprInfo* expr_infos;
+    size_t expr_infos_size;
+    size_t expr_infos_capacity;
+
+    /* Payloads too large for an operand. */
+    BigInt* integers;
+    size_t integers_size;
+    size_t integers_capacity;
+    AstString* names;
+    size_t names_size;
+    size_t names_capacity;
+
+    /* ItemKind of each item, and index into the array for its kind. */
+    uint8_t* item_kinds;
+    uint32_t* item_operands;
+    size_t items_size;
+    size_t items_capacity;
+
+    FunctionItem* function_items;
+    size_t function_items_size;
+    size_t function_items_capacity;
+
+    /* Top-level items of every module, each module a range. */
+    ItemId* module_items;
+    size_t module_items_size;
+    size_t module_items_capacity;
+} AstNodes;
+
+void AstNodes_init(AstNodes* nodes);
+void AstNodes_destroy(AstNodes* nodes);
+
+/** Remove all nodes but keep the memory for reuse. */
+void AstNodes_reset(AstNodes* nodes);
+
+/** Annotations of `expr` for writing, zeroed when first accessed. The pointer
+ * is invalidated by accessing a later expression. */
+ExprInfo* AstNodes_expr_info(AstNodes* nodes, ExprId expr);
+
+/**
+ * Extend `expr_infos` to every expression made so far. Until more are made,
+ * `AstNodes_expr_info` does not reallocate, so threads may annotate distinct
+ * expressions at the same time.
+ */
+void AstNodes_reserve_expr_infos(AstNodes* nodes);
 
 /*
  * Items
  */
 
+static inline ItemKind Item_kind(AstNodes const* nodes, ItemId item) {
+    return (ItemKind)nodes->item_kinds[item];
+}
+
 struct FunctionItem {
-    Item base;
     AstString name;
-    FunctionTypeExpr* type;
-    Expr* body;
+    /* FunctionTypeExpr */
+    ExprId type;
+    ExprId body;
 };
 
-FunctionItem* FunctionItem_new(
+ItemId FunctionItem_new(
     struct AstContext* ast,
     AstString name,
-    FunctionTypeExpr* type,
-    Expr* body
+    ExprId type,
+    ExprId body
 );
 
+static inline FunctionItem const* FunctionItem_get(
+    AstNodes const* nodes, ItemId item
+) {
+    return &nodes->function_items[nodes->item_operands[item]];
+}
+
+/*
+ * Modules
+ */
+
+/** Top-level items of a file in source order. */
+typedef struct Module {
+    uint32_t items_start;
+    uint32_t items_size;
+} Module;
+
+/** Start an empty module. Items must be added to it before starting another
+ * one. */
+void Module_init(struct AstContext* ast, Module* module);
+
+void Module_add_item(struct AstContext* ast, Module* module, ItemId item);
+
+static inline ItemId Module_item(
+    AstNodes const* nodes, Module const* module, size_t index
+) {
+    return nodes->module_items[module->items_start + index];
+}
+
 /*
  * Expressions
  */
 
-struct IntLiteralExpr {
-    Expr base;
-    BigInt value;
-};
+static inline ExprKind Expr_kind(AstNodes const* nodes, ExprId expr) {
+    return (ExprKind)nodes->expr_kinds[expr];
+}
 
-IntLiteralExpr* IntLiteralExpr_new(struct AstContext* ast, BigInt value);
+static inline ExprInfo const* Expr_info(AstNodes const* nodes, ExprId expr) {
+    static ExprInfo const empty_info = { NULL, NULL, 0 };
+    if (expr >= nodes->expr_infos_size) {
+        return &empty_info;
+    }
+    return &nodes->expr_infos[expr];
+}
 
-struct ReturnExpr {
-    Expr base;
-    Expr* value;
-};
+ExprId IntLiteralExpr_new(struct AstContext* ast, BigInt value);
 
-ReturnExpr* ReturnExpr_new(struct AstContext* ast, Expr* value);
+static inline BigInt IntLiteralExpr_value(
+    AstNodes const* nodes, ExprId expr
+) {
+    return nodes->integers[nodes->expr_operands[expr]];
+}
 
-struct NameExpr {
-    Expr base;
-    AstString name;
-};
+ExprId ReturnExpr_new(struct AstContext* ast, ExprId value);
 
-NameExpr* NameExpr_new(struct AstContext* ast, AstString name);
+static inline ExprId ReturnExpr_value(AstNodes const* nodes, ExprId expr) {
+    return nodes->expr_operands[expr];
+}
 
-struct SimpleTypeExpr {
-    Expr base;
-    SimpleTypeKind kind;
-};
+ExprId NameExpr_new(struct AstContext* ast, AstString name);
 
-SimpleTypeExpr* SimpleTypeExpr_new(struct AstContext* ast, SimpleTypeKind kind);
+static inline AstString NameExpr_name(AstNodes const* nodes, ExprId expr) {
+    return nodes->names[nodes->expr_operands[expr]];
+}
 
-struct FunctionTypeExpr {
-    Expr base;
-    Expr* return_type;
-};
+ExprId SimpleTypeExpr_new(struct AstContext* ast, SimpleTypeKind kind);
 
-FunctionTypeExpr* FunctionTypeExpr_new(
-    struct AstContext* ast, Expr* return_type
-);
+static inline SimpleTypeKind SimpleTypeExpr_kind(
+    AstNodes const* nodes, ExprId expr
+) {
+    return (SimpleTypeKind)nodes->expr_operands[expr];
+}
+
+ExprId FunctionTypeExpr_new(struct AstContext* ast, ExprId return_type);
+
+static inline ExprId FunctionTypeExpr_return_type(
+    AstNodes const* nodes, ExprId expr
+) {
+    return nodes->expr_operands[expr];
+}
 
 /*
  * Types
  */
 
-int Type_equal(Type const* left, Type const* right);
+/*
+ * Types are interned by their AstContext, so each distinct type exists once
+ * and is compared by identity. They are obtained from `AstContext_*_type`.
+ */
+
+static inline int Type_equal(Type const* left, Type const* right) {
+    return left == right;
+}
 
 StringRef Type_name(Type const* type);
 
@@ -159,13 +272,9 @@ struct SimpleType {
     SimpleTypeKind kind;
 };
 
-SimpleType* SimpleType_new(struct AstContext* ast, SimpleTypeKind kind);
-
 struct FunctionType {
     Type base;
     Type* return_type;
 };
 
-FunctionType* FunctionType_new(struct AstContext* ast, Type* return_type);
-
 #endif
@@ -1,5 +1,9 @@
 #include "src/ast/source.h"
 #include "src/ast/source_internal.h"
+#include "src/support/bits.h"
+#include "src/support/malloc.h"
+
+#include <assert.h>
 
 uint8_t const* SourceFile_data(SourceFile const* source) {
     return source->data;
@@ -12,3 +16,112 @@ size_t SourceFile_size(SourceFile const* source) {
 AstString SourceFile_path(SourceFile const* source) {
     return source->path;
 }
+
+/* First CR or LF at or after `cursor`, or `limit` if there is none. */
+static uint8_t const* find_line_terminator(
+    uint8_t const* cursor, uint8_t const* limit
+) {
+#if HAVE_SSE2
+    while (limit - cursor >= 16) {
+        __m128i block;
+        unsigned mask;
+        block = _mm_loadu_si128((__m128i const*)cursor);
+        mask = _mm_movemask_epi8(_mm_or_si128(
+            _mm_cmpeq_epi8(block, _mm_set1_epi8('\n')),
+            _mm_cmpeq_epi8(block, _mm_set1_epi8('\r'))
+        ));
+        if (mask != 0) {
+            return cursor + lowest_bit(mask);
+        }
+        cursor += 16;
+    }
+#endif
+
+    while (cursor < limit && cursor[0] != '\n' && cursor[0] != '\r') {
+        cursor += 1;
+    }
+
+    return cursor;
+}
+
+void SourceFile_build_line_starts(SourceFile* source) {
+    uint8_t const* cursor;
+    uint8_t const* limit;
+    size_t capacity = 0;
+
+    cursor = source->data;
+    limit = source->data + source->size;
+
+    /* The byte order mark is not part of the first line. */
+    if (
+        source->size >= 3
+        && cursor[0] == 0xEF
+        && cursor[1] == 0xBB
+        && cursor[2] == 0xBF
+    ) {
+        cursor += 3;
+    }
+
+    for (;;) {
+        source->line_starts = ensure_array_capacity(
+            sizeof(uint32_t),
+            source->line_starts,
+            &source->line_count,
+            &capacity,
+            64
+        );
+        source->line_starts[source->line_count] = cursor - source->data;
+        source->line_count += 1;
+
+        cursor = find_line_terminator(cursor, limit);
+        if (cursor == limit) {
+            break;
+        }
+        if (cursor[0] == '\r' && cursor[1] == '\n') {
+            cursor += 1;
+        }
+        cursor += 1;
+    }
+}
+
+SourcePos SourceFile_get_pos(
+    SourceFile const* source, uint32_t offset, uint32_t tab_stop
+) {
+    SourcePos pos;
+    size_t low;
+    size_t high;
+    uint8_t const* cursor;
+    uint8_t const* target;
+
+    assert(offset <= source->size);
+
+    /* Find the last line starting at or before `offset`. */
+    low = 0;
+    high = source->line_count;
+    while (high - low > 1) {
+        size_t middle;
+        middle = low + (high - low) / 2;
+        if (source->line_starts[middle] <= offset) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+
+    pos.line = low + 1;
+    pos.column = 1;
+
+    cursor = source->data + source->line_starts[low];
+    target = source->data + offset;
+
+    while (cursor < target) {
+        if (cursor[0] == '\t') {
+            pos.column += tab_stop - (pos.column % tab_stop);
+        } else if ((cursor[0] & 0xC0) != 0x80) {
+            pos.column += 1;
+        }
+        cursor += 1;
+    }
+
+    return pos;
+}
@@ -2,8 +2,12 @@
 #define _ZENO_SPEC_SRC_AST_SOURCE_H_
 
 #include "src/ast/string.h"
+#include "src/support/source_pos.h"
 #include "src/support/stdint.h"
 
+/** Tab stop used for columns unless configured otherwise. */
+#define DEFAULT_TAB_STOP 8
+
 /** Source file owned by an AstContext.
  * `data` is nul-terminated (`data[size] == 0`). */
 typedef struct SourceFile SourceFile;
@@ -14,4 +18,20 @@ size_t SourceFile_size(SourceFile const* source);
 
 AstString SourceFile_path(SourceFile const* source);
 
+/** Replacement of `removed_size` bytes at byte `offset` with `text`. */
+typedef struct SourceEdit {
+    uint32_t offset;
+    uint32_t removed_size;
+    StringRef text;
+} SourceEdit;
+
+/**
+ * Line and column of the character at byte `offset`. Lines end at LF, CRLF,
+ * or CR. Columns count characters from 1 with tabs advancing to the next
+ * multiple of `tab_stop`.
+ */
+SourcePos SourceFile_get_pos(
+    SourceFile const* source, uint32_t offset, uint32_t tab_stop
+);
+
 #endif
@@ -7,6 +7,14 @@ struct SourceFile {
     AstString path;
     uint8_t const* data;
     size_t size;
+    int is_mapped;
+
+    /* Byte offset of each line start. */
+    uint32_t* line_starts;
+    size_t line_count;
 };
 
+/* Fill in `line_starts` and `line_count`, once the data is in place. */
+void SourceFile_build_line_starts(SourceFile* source);
+
 #endif
@@ -3,9 +3,13 @@
 void AstString_init(AstString* string, StringRef value) {
     string->value = value;
     string->hash = StringRef_hash(value);
+    string->symbol = 0;
 }
 
 int AstString_equal(AstString const* left, AstString const* right) {
+    if (left->symbol != 0 && right->symbol != 0) {
+        return left->symbol == right->symbol;
+    }
     return StringRef_equal(left->value, right->value);
 }
 
@@ -4,10 +4,19 @@
 #include "src/support/stdint.h"
 #include "src/support/string_ref.h"
 
+/**
+ * ID of a string interned in an AstContext, from 1 up to the number of
+ * strings, so it can index side tables directly. 0 is no symbol. Within one
+ * context, strings are equal exactly when their symbols are.
+ */
+typedef uint32_t Symbol;
+
 /** String owned by an AstContext. */
 typedef struct AstString {
     StringRef value;
     uint32_t hash;
+    /* 0 until interned. */
+    Symbol symbol;
 } AstString;
 
 void AstString_init(AstString* string, StringRef value);
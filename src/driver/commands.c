@@ -6,6 +6,7 @@
 #include "src/parsing/parse.h"
 #include "src/sema/type_checking.h"
 #include "src/support/malloc.h"
+#include "src/support/thread.h"
 
 #include <assert.h>
 
@@ -208,10 +209,35 @@ static void parse_options(
     }
 }
 
-static void dump_tokens(Writer* writer, TokenList const* tokens) {
+static void dump_tokens(
+    Writer* writer, SourceFile const* source, TokenList const* tokens
+) {
+    TokenValue const* value;
     size_t i;
+
+    value = tokens->values;
+
     for (i = 0; i < tokens->size; i += 1) {
-        Token_dump(&tokens->data[i], writer);
+        TokenKind kind;
+        SourcePos pos;
+
+        kind = tokens->kinds[i];
+        pos = SourceFile_get_pos(source, tokens->offsets[i], DEFAULT_TAB_STOP);
+        Token_dump(kind, value, pos, writer);
+
+        if (TokenKind_has_value(kind)) {
+            value += 1;
+        }
+    }
+}
+
+static void dump_module(AstContext* ast, Module const* module) {
+    AstNodes const* nodes;
+    size_t i;
+
+    nodes = AstContext_nodes(ast);
+    for (i = 0; i < module->items_size; i += 1) {
+        Item_dump(nodes, Module_item(nodes, module, i), Writer_stdout);
     }
 }
 
@@ -219,22 +245,30 @@ static void do_compile(
     DiagnosticEngine* diagnostics,
     Options const* options,
     AstContext* ast,
-    FunctionItem* item,
+    Module const* module,
     Command command
 ) {
-    BytecodeFunction* bytecode_function;
+    AstNodes const* nodes;
+    size_t i;
 
-    bytecode_function = compile_function(item);
-    BytecodeFunction_dump(bytecode_function, Writer_stdout);
+    nodes = AstContext_nodes(ast);
+    for (i = 0; i < module->items_size; i += 1) {
+        BytecodeFunction* bytecode_function;
 
-    BytecodeFunction_delete(bytecode_function);
+        bytecode_function = compile_function(
+            nodes, Module_item(nodes, module, i)
+        );
+        BytecodeFunction_dump(bytecode_function, Writer_stdout);
+
+        BytecodeFunction_delete(bytecode_function);
+    }
 }
 
 static void do_check(
     DiagnosticEngine* diagnostics,
     Options const* options,
     AstContext* ast,
-    FunctionItem* item,
+    Module const* module,
     Command command
 ) {
     TypeCheckResult check_result;
@@ -248,19 +282,19 @@ static void do_check(
         }
     }
 
-    type_check(&check_result, ast, item);
+    type_check_module(&check_result, ast, module, Thread_cpu_count());
 
     switch (check_result.kind) {
     case TypeCheckResultKind_Success:
         if (command == Command_Check) {
             if (!options->quiet && !options->expect_failure) {
-                FunctionItem_dump(item, Writer_stdout);
+                dump_module(ast, module);
             }
             if (options->expect_failure) {
                 report_check_unexpected_success(diagnostics);
             }
         } else {
-            do_compile(diagnostics, options, ast, item, command);
+            do_compile(diagnostics, options, ast, module, command);
         }
         break;
 
@@ -288,10 +322,11 @@ static void do_parse(
     DiagnosticEngine* diagnostics,
     Options const* options,
     AstContext* ast,
-    TokenList const* tokens,
+    SourceFile const* source,
     Command command
 ) {
     ParseResult parse_result;
+    Lexer* lexer;
     DiagnosticLevel error_level = DiagnosticLevel_Error;
 
     if (command == Command_Parse && options->expect_failure) {
@@ -302,15 +337,15 @@ static void do_parse(
         }
     }
 
-    parse(&parse_result, ast, tokens);
+    lexer = Lexer_new(ast, source);
+    parse(&parse_result, ast, lexer);
+    Lexer_delete(lexer);
 
     switch (parse_result.kind) {
     case ParseResultKind_Success:
         if (command == Command_Parse) {
             if (!options->quiet && !options->expect_failure) {
-                FunctionItem_dump(
-                    (FunctionItem*)parse_result.u.item, Writer_stdout
-                );
+                dump_module(ast, &parse_result.u.module);
             }
             if (options->expect_failure) {
                 report_parse_unexpected_success(diagnostics);
@@ -320,7 +355,7 @@ static void do_parse(
                 diagnostics,
                 options,
                 ast,
-                (FunctionItem*)parse_result.u.item,
+                &parse_result.u.module,
                 command
             );
         }
@@ -335,6 +370,15 @@ static void do_parse(
         );
         break;
 
+    case ParseResultKind_LexError:
+        report_lex_error(
+            diagnostics,
+            options->path,
+            &parse_result.u.lex_error,
+            DiagnosticLevel_Error
+        );
+        break;
+
     case ParseResultKind_YaccError:
         report_yacc_error(diagnostics, parse_result.u.yacc_error);
         break;
@@ -368,23 +412,23 @@ static void do_syntax(
         return;
     }
 
-    lex_source(&lex_result, ast, source, NULL);
+    if (command != Command_Tokenize) {
+        /* The parser pulls tokens from the lexer as it goes. */
+        do_parse(diagnostics, options, ast, source, command);
+        return;
+    }
+
+    lex_source_parallel(&lex_result, ast, source, Thread_cpu_count());
 
     if (lex_result.is_tokens) {
-        if (command == Command_Tokenize) {
-            if (!options->quiet && !options->expect_failure) {
-                dump_tokens(Writer_stdout, &lex_result.u.tokens);
-            }
-            if (options->expect_failure) {
-                report_tokenize_unexpected_success(diagnostics);
-            }
-        } else {
-            do_parse(
-                diagnostics, options, ast, &lex_result.u.tokens, command
-            );
+        if (!options->quiet && !options->expect_failure) {
+            dump_tokens(Writer_stdout, source, &lex_result.u.tokens);
+        }
+        if (options->expect_failure) {
+            report_tokenize_unexpected_success(diagnostics);
         }
 
-        xfree(lex_result.u.tokens.data);
+        TokenList_destroy(&lex_result.u.tokens);
     } else {
         report_lex_error(
             diagnostics,
@@ -12,6 +12,9 @@ static void TerminalDiagnosticConsumer_handle(
 
     consumer = (TerminalDiagnosticConsumer*)base_consumer;
 
+    /* Keep diagnostics ordered after normal output. */
+    Writer_flush(Writer_stdout);
+
     if (diagnostic->source_name.size == 0) {
         Writer_write_str(consumer->writer, consumer->program_name);
     } else {
@@ -47,6 +50,7 @@ static void TerminalDiagnosticConsumer_handle(
 
     Writer_write_str(consumer->writer, diagnostic->message);
     Writer_write_zstr(consumer->writer, "\n");
+    Writer_flush(consumer->writer);
 }
 
 void TerminalDiagnosticConsumer_init(
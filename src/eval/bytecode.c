@@ -3,7 +3,7 @@
 #include "src/support/io.h"
 
 BytecodeFunction* BytecodeFunction_new(
-    struct FunctionItem const* item, uint8_t* code_data, size_t code_size
+    ItemId item, uint8_t* code_data, size_t code_size
 ) {
     BytecodeFunction* func;
     func = xmalloc(sizeof(BytecodeFunction));
@@ -1,9 +1,9 @@
 #ifndef _ZENO_SPEC_SRC_EVAL_BYTECODE_H
 #define _ZENO_SPEC_SRC_EVAL_BYTECODE_H
 
+#include "src/ast/nodes.h"
 #include "src/support/stdint.h"
 
-struct FunctionItem;
 struct Writer;
 
 #define OPCODE_LIST(X) \
@@ -19,14 +19,14 @@ typedef enum Opcode {
 } Opcode;
 
 typedef struct BytecodeFunction {
-    struct FunctionItem const* item;
+    ItemId item;
     uint8_t const* code;
     size_t code_size;
 } BytecodeFunction;
 
 /* Takes ownership of code data. */
 BytecodeFunction* BytecodeFunction_new(
-    struct FunctionItem const* item, uint8_t* code_data, size_t code_size
+    ItemId item, uint8_t* code_data, size_t code_size
 );
 void BytecodeFunction_delete(BytecodeFunction* function);
 void BytecodeFunction_dump(
@@ -5,6 +5,7 @@
 #include <assert.h>
 
 typedef struct CompileContext {
+    AstNodes const* nodes;
     uint8_t* data;
     size_t size;
     size_t capacity;
@@ -29,16 +30,19 @@ static void emit_u32(CompileContext* context, uint32_t value) {
     context->size += 4;
 }
 
-static void compile_expr(CompileContext* context, Expr const* expr) {
-    switch (expr->kind) {
+static void compile_expr(CompileContext* context, ExprId expr) {
+    switch (Expr_kind(context->nodes, expr)) {
     case ExprKind_Return:
-        compile_expr(context, ((ReturnExpr*)expr)->value);
+        compile_expr(context, ReturnExpr_value(context->nodes, expr));
         emit_u8(context, Opcode_Return);
         return;
 
     case ExprKind_IntLiteral:
         emit_u8(context, Opcode_PushInt32);
-        emit_u32(context, BigInt_as_uint32(((IntLiteralExpr*)expr)->value));
+        emit_u32(
+            context,
+            BigInt_as_uint32(IntLiteralExpr_value(context->nodes, expr))
+        );
         return;
 
     case ExprKind_SimpleType:
@@ -52,14 +56,15 @@ static void compile_expr(CompileContext* context, Expr const* expr) {
     }
 }
 
-BytecodeFunction* compile_function(FunctionItem const* function) {
+BytecodeFunction* compile_function(AstNodes const* nodes, ItemId function) {
     CompileContext context;
 
+    context.nodes = nodes;
     context.data = NULL;
     context.size = 0;
     context.capacity = 0;
 
-    compile_expr(&context, function->body);
+    compile_expr(&context, FunctionItem_get(nodes, function)->body);
 
     return BytecodeFunction_new(
         function,
@@ -1,8 +1,9 @@
 #ifndef _ZENO_SPEC_SRC_EVAL_COMPILE_H
 #define _ZENO_SPEC_SRC_EVAL_COMPILE_H
 
+#include "src/ast/nodes.h"
 #include "src/eval/bytecode.h"
 
-BytecodeFunction* compile_function(struct FunctionItem const* function);
+BytecodeFunction* compile_function(AstNodes const* nodes, ItemId function);
 
 #endif
@@ -0,0 +1,131 @@
+#undef NDEBUG
+
+/*
+ * Compare keyword recognition against the linear memcmp chain it replaced.
+ * Usage: keyword_bench FILE...
+ */
+
+#include "src/parsing/token.h"
+#include "src/support/bench_input.h"
+#include "src/support/io.h"
+#include "src/support/malloc.h"
+
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+
+/* Identifiers looked up per run, and runs per method. */
+#define BENCH_LOOKUPS 20000000
+#define BENCH_RUNS 5
+
+static TokenKind linear_keyword_kind(uint8_t const* data, size_t size) {
+    #define X(name, str)                                                 \
+        if ((sizeof(str) - 1) == size && memcmp(data, str, size) == 0) { \
+            return TokenKind_##name;                                     \
+        }
+    KEYWORD_KIND_LIST(X)
+    #undef X
+    return TokenKind_Identifier;
+}
+
+typedef TokenKind (*KeywordFunction)(uint8_t const* data, size_t size);
+
+/* Report the fastest of several runs, since the first is cold and the
+ * others may be disturbed by other processes. */
+static void bench(
+    char const* name,
+    KeywordFunction function,
+    StringRef const* identifiers,
+    size_t size,
+    size_t reps
+) {
+    clock_t best = 0;
+    unsigned keywords = 0;
+    int run;
+
+    for (run = 0; run < BENCH_RUNS; run += 1) {
+        clock_t start;
+        clock_t elapsed;
+        size_t rep;
+        size_t i;
+
+        keywords = 0;
+        start = clock();
+        for (rep = 0; rep < reps; rep += 1) {
+            for (i = 0; i < size; i += 1) {
+                keywords += function(identifiers[i].data, identifiers[i].size)
+                    != TokenKind_Identifier;
+            }
+        }
+        elapsed = clock() - start;
+
+        if (run == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    Writer_format(
+        Writer_stdout,
+        "%s: %u ms, %u keywords\n",
+        name,
+        (unsigned)((unsigned long)best * 1000 / CLOCKS_PER_SEC),
+        keywords
+    );
+}
+
+int main(int argc, char** argv) {
+    uint8_t** files;
+    StringRef* identifiers = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+    size_t reps;
+    size_t i;
+    int arg;
+
+    TokenKind_init_keywords();
+
+    files = xallocarray(argc, sizeof(uint8_t*));
+
+    for (arg = 1; arg < argc; arg += 1) {
+        size_t data_size;
+
+        files[arg] = read_bench_file(argv[arg], &data_size);
+        if (files[arg] != NULL) {
+            identifiers = collect_identifiers(
+                identifiers, &size, &capacity, files[arg], data_size
+            );
+        }
+    }
+
+    if (size == 0) {
+        Writer_format(Writer_stderr, "no identifiers\n");
+        return 1;
+    }
+
+    for (i = 0; i < size; i += 1) {
+        assert(
+            linear_keyword_kind(identifiers[i].data, identifiers[i].size)
+            == TokenKind_from_identifier(
+                identifiers[i].data, identifiers[i].size
+            )
+        );
+    }
+
+    reps = BENCH_LOOKUPS / size + 1;
+    Writer_format(
+        Writer_stdout,
+        "%u identifiers, %u passes\n",
+        (unsigned)size,
+        (unsigned)reps
+    );
+
+    bench("linear", linear_keyword_kind, identifiers, size, reps);
+    bench("table", TokenKind_from_identifier, identifiers, size, reps);
+
+    xfree(identifiers);
+    for (arg = 1; arg < argc; arg += 1) {
+        xfree(files[arg]);
+    }
+    xfree(files);
+    return 0;
+}
@@ -1,312 +1,742 @@
 #include "src/parsing/lex.h"
 #include "src/parsing/limits.h"
+#include "src/support/bits.h"
 #include "src/support/encoding.h"
+#include "src/support/hash_map.h"
 #include "src/support/malloc.h"
+#include "src/support/thread.h"
 
 #include <assert.h>
 #include <string.h>
 
 typedef struct LexContext {
     AstContext* ast;
-    LexerConfig config;
 
+    uint8_t const* data;
     uint8_t const* cursor;
     uint8_t const* limit;
-
-    SourcePos token_pos;
-    SourcePos cursor_pos;
-
-    uint32_t characters_in_line;
-    uint32_t total_characters;
+    /* End of the valid UTF-8 prefix of the source. */
+    uint8_t const* valid_limit;
+    /* Lexing stops with EndOfFile after a newline ending here. */
+    uint8_t const* chunk_end;
+
+    uint8_t const* token_start;
+
+    /*
+     * Limits are checked up front by `find_limit_overflow`. Moving the cursor
+     * past `overflow_cursor` reports `overflow_error` at `overflow_start`.
+     * Without an overflow, `overflow_cursor` is `limit` and never passed.
+     */
+    uint8_t const* overflow_cursor;
+    uint8_t const* overflow_start;
+    LexErrorKind overflow_error;
 
     jmp_buf exit_jmp_buf;
 
-    /* Success result */
-    Token* tokens_data;
-    size_t tokens_size;
-    size_t tokens_capacity;
+    /* Token result of `lex_token` */
+    Token token;
 
     /* Error result */
     LexError error;
+
+    /* Tokens collected by `lex_source` */
+    TokenList tokens;
+    size_t tokens_capacity;
+    size_t values_capacity;
+
+    /*
+     * Chunks lexed in parallel intern names in `strings`, a Set[AstString]
+     * borrowing from the source, and record the ID of each identifier's name
+     * in `string_ids`. NULL to intern in the AstContext directly.
+     */
+    HashMap* strings;
+    uint32_t* string_ids;
+    size_t string_ids_size;
+    size_t string_ids_capacity;
+
+    /* Arena for integer literals too large to store inline. Chunks lexed in
+     * parallel have their own, copied out when merging. */
+    Arena* arena;
 } LexContext;
 
-static void sync_token_pos_to_cursor(LexContext* context) {
-    context->token_pos = context->cursor_pos;
+static HashMapConfig const string_set_config = HASH_SET_CONFIG(
+    AstString, AstString_hash_generic, AstString_equal_generic
+);
+
+static void sync_token_start_to_cursor(LexContext* context) {
+    context->token_start = context->cursor;
 }
 
-static void push_token(LexContext* context, TokenKind kind) {
-    Token* token;
-    context->tokens_data = ensure_array_capacity(
-        sizeof(Token),
-        context->tokens_data,
-        &context->tokens_size,
-        &context->tokens_capacity,
-        1
-    );
-    token = &context->tokens_data[context->tokens_size];
-    context->tokens_size += 1;
-    token->kind = kind;
-    token->pos = context->token_pos;
+static void set_token(LexContext* context, TokenKind kind) {
+    context->token.kind = kind;
+    context->token.offset = context->token_start - context->data;
 }
 
-static void push_integer_token(
+static void set_integer_token(
     LexContext* context, TokenKind kind, BigInt integer
 ) {
-    push_token(context, kind);
-    context->tokens_data[context->tokens_size - 1].value.integer = integer;
+    set_token(context, kind);
+    context->token.value.integer = integer;
 }
 
-static void push_string_token(
+static void set_string_token(
     LexContext* context, TokenKind kind, StringRef string
 ) {
-    push_token(context, kind);
-    context->tokens_data[context->tokens_size - 1].value.string =
-        AstContext_add_string(context->ast, string);
+    uint32_t id;
+
+    set_token(context, kind);
+
+    if (context->strings == NULL) {
+        context->token.value.string =
+            AstContext_add_string(context->ast, string);
+        return;
+    }
+
+    AstString_init(&context->token.value.string, string);
+    id = HashMap_get_or_insert(
+        context->strings,
+        &string_set_config,
+        &context->token.value.string,
+        NULL,
+        NULL,
+        NULL
+    );
+
+    context->string_ids = ensure_array_capacity(
+        sizeof(uint32_t),
+        context->string_ids,
+        &context->string_ids_size,
+        &context->string_ids_capacity,
+        1
+    );
+    context->string_ids[context->string_ids_size] = id;
+    context->string_ids_size += 1;
+}
+
+/*
+ * Everything before the cursor has been lexed when an error is found, so a
+ * limit exceeded by that text is reported instead.
+ */
+static void exit_with_error(LexContext* context, LexErrorKind error) {
+    if (context->cursor > context->overflow_cursor) {
+        context->token_start = context->overflow_start;
+        error = context->overflow_error;
+    }
+
+    context->error.kind = error;
+    context->error.offset = context->token_start - context->data;
+
+    longjmp(context->exit_jmp_buf, 1);
 }
 
 static void exit_with_character_error(
     LexContext* context, LexErrorKind error, int32_t character
 ) {
-    context->error.kind = error;
-    context->error.pos = context->token_pos;
     context->error.value.character = character;
-
-    longjmp(context->exit_jmp_buf, 1);
+    exit_with_error(context, error);
 }
 
-static void exit_with_error(LexContext* context, LexErrorKind error) {
-    context->error.kind = error;
-    context->error.pos = context->token_pos;
+/*
+ * Classification
+ */
 
-    longjmp(context->exit_jmp_buf, 1);
+typedef enum CharClass {
+    CharClass_IdStart = 1 << 0,
+    CharClass_IdContinue = 1 << 1,
+    CharClass_BinaryDigit = 1 << 2,
+    CharClass_DecimalDigit = 1 << 3,
+    CharClass_HexDigit = 1 << 4,
+    CharClass_Whitespace = 1 << 5,
+    CharClass_Symbol = 1 << 6
+} CharClass;
+
+/* Shorthands for the table below. */
+#define NC 0
+#define WS CharClass_Whitespace
+#define SY CharClass_Symbol
+#define LT (CharClass_IdStart | CharClass_IdContinue)
+#define HL (LT | CharClass_HexDigit)
+#define DD (CharClass_IdContinue | CharClass_DecimalDigit | CharClass_HexDigit)
+#define BD (DD | CharClass_BinaryDigit)
+
+/* Classes of ASCII bytes. Bytes >= 0x80 have no class and are decoded with
+ * utf8_decode by the slow path. */
+static uint8_t const char_classes[256] = {
+    NC, NC, NC, NC, NC, NC, NC, NC, NC, WS, WS, NC, NC, WS, NC, NC,
+    NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC,
+    WS, SY, NC, NC, NC, SY, SY, NC, SY, SY, SY, SY, SY, SY, SY, SY,
+    BD, BD, DD, DD, DD, DD, DD, DD, DD, DD, SY, SY, SY, SY, SY, NC,
+    SY, HL, HL, HL, HL, HL, HL, LT, LT, LT, LT, LT, LT, LT, LT, LT,
+    LT, LT, LT, LT, LT, LT, LT, LT, LT, LT, LT, SY, NC, SY, SY, LT,
+    NC, HL, HL, HL, HL, HL, HL, LT, LT, LT, LT, LT, LT, LT, LT, LT,
+    LT, LT, LT, LT, LT, LT, LT, LT, LT, LT, LT, SY, SY, SY, SY, NC,
+    NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC,
+    NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC,
+    NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC,
+    NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC,
+    NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC,
+    NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC,
+    NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC,
+    NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC, NC
+};
+
+#undef NC
+#undef WS
+#undef SY
+#undef LT
+#undef HL
+#undef DD
+#undef BD
+
+static int has_class(uint8_t ch, CharClass classes) {
+    return (char_classes[ch] & classes) != 0;
 }
 
-static void increment_line(LexContext* context) {
-    context->cursor_pos.line += 1;
-    context->cursor_pos.column = 1;
-    context->characters_in_line = 0;
+static CharClass digit_class(int base) {
+    switch (base) {
+    case 2:
+        return CharClass_BinaryDigit;
+    case 16:
+        return CharClass_HexDigit;
+    default:
+        assert(base == 10);
+        return CharClass_DecimalDigit;
+    }
+}
 
-    if (context->cursor_pos.line > MAX_LINES_PER_FILE) {
-        sync_token_pos_to_cursor(context);
-        exit_with_error(context, LexErrorKind_LineLimitExceeded);
+/* Skip a run of bytes in `classes`. */
+static void skip_class_run(LexContext* context, CharClass classes) {
+    while (has_class(context->cursor[0], classes)) {
+        context->cursor += 1;
     }
 }
 
-static void handle_invisible_character(LexContext* context) {
-    context->characters_in_line += 1;
-    context->total_characters += 1;
+/*
+ * Bulk scanning
+ *
+ * Comment text and indentation are skipped a block at a time. Each block
+ * gives a bit mask of the bytes that need individual attention, control
+ * characters and stop bytes, which are handled one at a time as before.
+ * Non-ASCII text is skipped in bulk too, up to the first invalid UTF-8 found
+ * by `utf8_valid_prefix_size`. Blocks are only loaded when they fit before the
+ * limit, and the rest is scanned a byte at a time. Define ZENO_NO_SIMD to use
+ * the portable version.
+ */
 
-    if (context->characters_in_line > MAX_CHARACTERS_PER_LINE) {
-        sync_token_pos_to_cursor(context);
-        exit_with_error(context, LexErrorKind_ColumnLimitExceeded);
-    }
+#define SCAN_BLOCK_SIZE 16
+
+/* Printable bytes a run of text stops at, besides control bytes. Runs that
+ * need none use the rare DEL instead. */
+typedef struct ScanStops {
+    uint8_t bytes[2];
+} ScanStops;
+
+static ScanStops const no_stops = { { 0x7F, 0x7F } };
+static ScanStops const block_comment_stops = { { '*', '/' } };
+
+#if HAVE_SSE2
+
+static unsigned scan_block_stops(uint8_t const* p, ScanStops const* stops) {
+    __m128i block;
+    __m128i match;
+    block = _mm_loadu_si128((__m128i const*)p);
+    match = _mm_or_si128(
+        _mm_or_si128(
+            _mm_cmpeq_epi8(block, _mm_set1_epi8((char)stops->bytes[0])),
+            _mm_cmpeq_epi8(block, _mm_set1_epi8((char)stops->bytes[1]))
+        ),
+        /* Unsigned block <= 0x1F */
+        _mm_cmpeq_epi8(_mm_min_epu8(block, _mm_set1_epi8(0x1F)), block)
+    );
+    return _mm_movemask_epi8(match);
+}
 
-    if (context->total_characters > MAX_CHARACTERS_PER_FILE) {
-        sync_token_pos_to_cursor(context);
-        exit_with_error(context, LexErrorKind_CharacterLimitExceeded);
-    }
+/* Continuation bytes are 0x80 to 0xBF, which is below -64 signed. */
+static unsigned scan_block_continuations(uint8_t const* p) {
+    __m128i block;
+    block = _mm_loadu_si128((__m128i const*)p);
+    return _mm_movemask_epi8(_mm_cmplt_epi8(block, _mm_set1_epi8(-64)));
 }
 
-static void handle_normal_character(LexContext* context) {
-    context->cursor_pos.column += 1;
-    handle_invisible_character(context);
+static unsigned scan_block_not_space(uint8_t const* p) {
+    __m128i block;
+    block = _mm_loadu_si128((__m128i const*)p);
+    return ~_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')))
+        & 0xFFFF;
 }
 
-static void handle_tab(LexContext* context) {
-    context->cursor_pos.column +=
-        context->config.tab_stop
-        - (context->cursor_pos.column % context->config.tab_stop);
-    handle_invisible_character(context);
+#else
+
+/* Portable version processing 8 bytes per 64-bit word. */
+
+#define BYTES_60 UINT64_C(0x6060606060606060)
+
+/* High bit set exactly in the bytes below 0x20. */
+static uint64_t word_control(uint64_t word) {
+    return ~(((word & BYTES_7F) + BYTES_60) | word);
 }
 
-static void handle_crlf_line_terminator(LexContext* context) {
-    handle_invisible_character(context);
-    handle_invisible_character(context);
-    increment_line(context);
+static unsigned word_stops(uint64_t word, ScanStops const* stops) {
+    return word_high_bits(
+        word_control(word)
+        | word_equal(word, stops->bytes[0])
+        | word_equal(word, stops->bytes[1])
+    );
+}
+
+static unsigned scan_block_stops(uint8_t const* p, ScanStops const* stops) {
+    return word_stops(load_word(p), stops)
+        | (word_stops(load_word(p + 8), stops) << 8);
+}
+
+static unsigned scan_block_not_space(uint8_t const* p) {
+    return (word_high_bits(~word_equal(load_word(p), ' '))
+        | (word_high_bits(~word_equal(load_word(p + 8), ' ')) << 8));
 }
 
-static void handle_line_terminator(LexContext* context) {
-    handle_invisible_character(context);
-    increment_line(context);
+/* Continuation bytes have the top two bits set to 10. */
+static unsigned scan_block_continuations(uint8_t const* p) {
+    uint64_t low;
+    uint64_t high;
+    low = load_word(p);
+    high = load_word(p + 8);
+    return word_high_bits(low & ~(low << 1))
+        | (word_high_bits(high & ~(high << 1)) << 8);
 }
 
+#endif
+
 /*
- * Classification
+ * Length of the run of text at `cursor` without control bytes or `stops`,
+ * where `limit` is the end of the valid UTF-8.
  */
+static size_t plain_run_length(
+    uint8_t const* cursor, uint8_t const* limit, ScanStops const* stops
+) {
+    uint8_t const* start;
+
+    start = cursor;
+
+    while (limit - cursor >= SCAN_BLOCK_SIZE) {
+        unsigned mask;
+        mask = scan_block_stops(cursor, stops);
+        if (mask != 0) {
+            return (cursor - start) + lowest_bit(mask);
+        }
+        cursor += SCAN_BLOCK_SIZE;
+    }
+
+    while (
+        cursor < limit
+        && (cursor[0] >= 0x80 || (
+            cursor[0] >= 0x20
+            && cursor[0] != stops->bytes[0]
+            && cursor[0] != stops->bytes[1]
+        ))
+    ) {
+        cursor += 1;
+    }
 
-static int is_id_start(int32_t ch) {
-    return (ch >= 'a' && ch <= 'z')
-        || (ch >= 'A' && ch <= 'Z')
-        || (ch == '_');
+    return cursor - start;
 }
 
-static int is_id_continue(int32_t ch) {
-    return is_id_start(ch)
-        || (ch >= '0' && ch <= '9');
+/* Number of characters in the valid UTF-8 text from `cursor` to `end`. */
+static size_t count_characters(uint8_t const* cursor, uint8_t const* end) {
+    size_t continuations = 0;
+    size_t size;
+
+    size = end - cursor;
+
+    while (end - cursor >= SCAN_BLOCK_SIZE) {
+        continuations += count_bits(scan_block_continuations(cursor));
+        cursor += SCAN_BLOCK_SIZE;
+    }
+
+    while (cursor < end) {
+        if ((cursor[0] & 0xC0) == 0x80) {
+            continuations += 1;
+        }
+        cursor += 1;
+    }
+
+    return size - continuations;
 }
 
-static int is_digit(int32_t ch, int base) {
-    if (ch >= '0' && ch <= '9') {
-        return (ch - '0') < base;
-    } else if (ch >= 'a' && ch <= 'z') {
-        return (ch - 'a' + 10) < base;
-    } else if (ch >= 'A' && ch <= 'Z') {
-        return (ch - 'A' + 10) < base;
+/* Length of the run of spaces at `cursor`. */
+static size_t space_run_length(uint8_t const* cursor, uint8_t const* limit) {
+    uint8_t const* start;
+
+    start = cursor;
+
+    while (limit - cursor >= SCAN_BLOCK_SIZE) {
+        unsigned mask;
+        mask = scan_block_not_space(cursor);
+        if (mask != 0) {
+            return (cursor - start) + lowest_bit(mask);
+        }
+        cursor += SCAN_BLOCK_SIZE;
     }
-    return false;
+
+    /* The nul terminator stops the run at the limit. */
+    while (cursor[0] == ' ') {
+        cursor += 1;
+    }
+
+    return cursor - start;
+}
+
+/*
+ * Limits
+ *
+ * Lines and characters are counted in a single pass before lexing, which
+ * leaves the lexer to compare its cursor against the first character over a
+ * limit. Line terminators count as characters of the line they end, with CRLF
+ * counting as two. Limit errors are reported after the offending character,
+ * except that line terminators don't advance the column.
+ */
+
+static void set_limit_overflow(
+    LexContext* context,
+    LexErrorKind error,
+    uint8_t const* character,
+    uint8_t const* start
+) {
+    context->overflow_error = error;
+    context->overflow_cursor = character;
+    context->overflow_start = start;
 }
 
-static TokenKind id_or_keyword(uint8_t const* data, size_t size) {
-    #define X(name, str)                                                 \
-        if ((sizeof(str) - 1) == size && memcmp(data, str, size) == 0) { \
-            return TokenKind_##name;                                     \
+/* Check the lines from `cursor`, which starts a line, to `limit`. */
+static void find_limit_overflow(
+    LexContext* context,
+    uint8_t const* cursor,
+    uint8_t const* limit,
+    uint32_t total_characters
+) {
+    uint32_t lines = 1;
+    uint32_t characters_in_line = 0;
+
+    context->overflow_cursor = context->limit;
+
+    for (;;) {
+        uint8_t const* character;
+        uint8_t const* start;
+        uint8_t const* run_end;
+        size_t characters;
+        int is_line_terminator;
+
+        run_end = cursor + plain_run_length(cursor, limit, &no_stops);
+        characters = count_characters(cursor, run_end);
+
+        if (
+            characters_in_line + characters > MAX_CHARACTERS_PER_LINE
+            || total_characters + characters > MAX_CHARACTERS_PER_FILE
+        ) {
+            /* Go one character at a time to find the exact one. */
+            for (;;) {
+                character = cursor;
+                do {
+                    cursor += 1;
+                } while (cursor < run_end && (cursor[0] & 0xC0) == 0x80);
+
+                characters_in_line += 1;
+                total_characters += 1;
+
+                if (characters_in_line > MAX_CHARACTERS_PER_LINE) {
+                    set_limit_overflow(
+                        context,
+                        LexErrorKind_ColumnLimitExceeded,
+                        character,
+                        cursor
+                    );
+                    return;
+                }
+                if (total_characters > MAX_CHARACTERS_PER_FILE) {
+                    set_limit_overflow(
+                        context,
+                        LexErrorKind_CharacterLimitExceeded,
+                        character,
+                        cursor
+                    );
+                    return;
+                }
+            }
+        }
+
+        cursor = run_end;
+        characters_in_line += characters;
+        total_characters += characters;
+
+        if (cursor == limit) {
+            return;
         }
-    KEYWORD_KIND_LIST(X)
-    #undef X
-    return TokenKind_Identifier;
+
+        /* A control byte, which is a character of its own. */
+        character = cursor;
+        is_line_terminator = cursor[0] == '\r' || cursor[0] == '\n';
+
+        if (cursor[0] == '\r' && cursor[1] == '\n') {
+            cursor += 2;
+            characters = 2;
+        } else {
+            cursor += 1;
+            characters = 1;
+        }
+
+        start = is_line_terminator ? character : cursor;
+
+        while (characters > 0) {
+            characters_in_line += 1;
+            total_characters += 1;
+
+            if (characters_in_line > MAX_CHARACTERS_PER_LINE) {
+                set_limit_overflow(
+                    context,
+                    LexErrorKind_ColumnLimitExceeded,
+                    character,
+                    start
+                );
+                return;
+            }
+            if (total_characters > MAX_CHARACTERS_PER_FILE) {
+                set_limit_overflow(
+                    context,
+                    LexErrorKind_CharacterLimitExceeded,
+                    character,
+                    start
+                );
+                return;
+            }
+
+            characters -= 1;
+        }
+
+        if (is_line_terminator) {
+            lines += 1;
+            characters_in_line = 0;
+
+            if (lines > MAX_LINES_PER_FILE) {
+                set_limit_overflow(
+                    context, LexErrorKind_LineLimitExceeded, character, cursor
+                );
+                return;
+            }
+        }
+    }
 }
 
 /*
  * Comments
  */
 
-static int lex_line_comment(LexContext* context) {
+static void lex_line_comment(LexContext* context) {
     uint8_t const* cursor;
 
     assert(context->cursor[0] == '/');
     assert(context->cursor[1] == '/');
     context->cursor += 2;
-    handle_normal_character(context);
-    handle_normal_character(context);
-
-    cursor = context->cursor;
 
     for (;;) {
         int32_t ch;
+
+        context->cursor += plain_run_length(
+            context->cursor, context->valid_limit, &no_stops
+        );
+
+        cursor = context->cursor;
         ch = utf8_decode(&cursor, context->limit);
         if (ch == '\r' || ch == '\n' || ch == U_EOF) {
-            break;
+            return;
         }
         if (ch == U_BAD) {
-            sync_token_pos_to_cursor(context);
+            sync_token_start_to_cursor(context);
             exit_with_error(context, LexErrorKind_BadEncoding);
-            return false;
         }
         context->cursor = cursor;
-        handle_normal_character(context);
     }
-
-    return true;
 }
 
-static int lex_block_comment(LexContext* context) {
+static void lex_block_comment(LexContext* context) {
     uint8_t const* cursor;
     unsigned nesting;
 
     assert(context->cursor[0] == '/');
     assert(context->cursor[1] == '*');
     context->cursor += 2;
-    handle_normal_character(context);
-    handle_normal_character(context);
 
-    cursor = context->cursor;
     nesting = 1;
 
     while (nesting > 0) {
         int32_t ch;
+
+        context->cursor += plain_run_length(
+            context->cursor, context->valid_limit, &block_comment_stops
+        );
+
+        cursor = context->cursor;
         ch = utf8_decode(&cursor, context->limit);
         switch (ch) {
         case U_EOF:
-            sync_token_pos_to_cursor(context);
+            sync_token_start_to_cursor(context);
             exit_with_error(context, LexErrorKind_UnclosedBlockComment);
-            return false;
+            break;
         case U_BAD:
-            sync_token_pos_to_cursor(context);
+            sync_token_start_to_cursor(context);
             exit_with_error(context, LexErrorKind_BadEncoding);
-            return false;
-        case '\r':
-            if (cursor[0] == '\n') {
-                cursor += 1;
-                handle_crlf_line_terminator(context);
-                break;
-            }
-            /* fallthrough */
-        case '\n':
-            handle_line_terminator(context);
-            break;
-        case '\t':
-            handle_tab(context);
             break;
         case '*':
             if (cursor[0] == '/') {
                 nesting -= 1;
                 cursor += 1;
-                handle_normal_character(context);
-                handle_normal_character(context);
             }
             break;
         case '/':
             if (cursor[0] == '*') {
                 nesting += 1;
                 cursor += 1;
-                handle_normal_character(context);
-                handle_normal_character(context);
             }
             break;
         default:
-            handle_normal_character(context);
             break;
         }
         context->cursor = cursor;
     }
-
-    return true;
 }
 
 /*
  * Number literal
+ *
+ * Values are accumulated while scanning, eight decimal digits at a time where
+ * possible. Literals over 64 bits are parsed again by `BigInt_parse`.
+ * Values up to BIGINT_INLINE_MAX never touch the arena.
+ */
+
+/* True if all 8 bytes of `word` are decimal digits. The first part checks
+ * for a 3 high nibble, the second for a low nibble up to 9. */
+static int word_is_digits(uint64_t word) {
+    return (
+        (word & UINT64_C(0xF0F0F0F0F0F0F0F0))
+        | (((word + UINT64_C(0x0606060606060606))
+            & UINT64_C(0xF0F0F0F0F0F0F0F0)) >> 4)
+    ) == UINT64_C(0x3333333333333333);
+}
+
+/* Value of 8 decimal digits, the first one in the lowest byte. Each step
+ * combines neighbouring groups: digits into pairs, pairs into fours, fours
+ * into eight. */
+static uint64_t word_digits_value(uint64_t word) {
+    word -= UINT64_C(0x3030303030303030);
+    word = (word * 10 + (word >> 8)) & UINT64_C(0x00FF00FF00FF00FF);
+    word = (word * 100 + (word >> 16)) & UINT64_C(0x0000FFFF0000FFFF);
+    return (word * 10000 + (word >> 32)) & UINT64_C(0xFFFFFFFF);
+}
+
+static unsigned digit_value(uint8_t ch) {
+    if (ch <= '9') {
+        return ch - '0';
+    }
+    return (ch | 0x20) - 'a' + 10;
+}
+
+/*
+ * Consume a run of `base` digits, adding them to `*value`. Returns false if
+ * the value no longer fits 64 bits, with the rest of the run skipped.
  */
+static int scan_digit_run(LexContext* context, int base, uint64_t* value) {
+    uint8_t const* cursor;
+    CharClass digits;
+    uint64_t max_before_multiply;
+    uint64_t v;
+
+    cursor = context->cursor;
+    digits = digit_class(base);
+    v = *value;
+
+    if (base == 10) {
+        while (context->limit - cursor >= 8) {
+            uint64_t word;
+            uint64_t chunk;
+
+            word = load_word(cursor);
+            if (!word_is_digits(word)) {
+                break;
+            }
+
+            chunk = word_digits_value(word);
+            if (v > (UINT64_MAX - chunk) / 100000000) {
+                goto overflow;
+            }
+            v = v * 100000000 + chunk;
+            cursor += 8;
+        }
+    }
+
+    max_before_multiply = UINT64_MAX / base;
+
+    while (has_class(cursor[0], digits)) {
+        unsigned digit;
+
+        digit = digit_value(cursor[0]);
+        if (v > max_before_multiply || v * base > UINT64_MAX - digit) {
+            goto overflow;
+        }
+        v = v * base + digit;
+        cursor += 1;
+    }
+
+    context->cursor = cursor;
+    *value = v;
+    return true;
+
+overflow:
+    context->cursor = cursor;
+    skip_class_run(context, digits);
+    return false;
+}
 
 static void lex_number_literal(LexContext* context) {
     int base = 10;
+    CharClass digits;
     uint8_t const* digits_start;
+    uint64_t value = 0;
+    /* False once the value is too large for `value`. */
+    int is_exact = true;
 
     if (context->cursor[0] == '0') {
         if (context->cursor[1] == 'x' || context->cursor[1] == 'X') {
             context->cursor += 2;
-            handle_normal_character(context);
-            handle_normal_character(context);
             base = 16;
         } else if (context->cursor[1] == 'b' || context->cursor[1] == 'B') {
             base = 2;
             context->cursor += 2;
-            handle_normal_character(context);
-            handle_normal_character(context);
         } else {
             context->cursor += 1;
-            push_integer_token(
-                context, TokenKind_IntLiteral, BigInt_from_int(0)
+            set_integer_token(
+                context, TokenKind_IntLiteral, BigInt_from_int(NULL, 0)
             );
-            handle_normal_character(context);
-            if (is_id_continue(context->cursor[0])) {
+            if (has_class(context->cursor[0], CharClass_IdContinue)) {
                 exit_with_error(context, LexErrorKind_DecimalLeadingZero);
             }
             return;
         }
 
         /* Base prefix but no value (example: `0x`) */
-        if (!is_digit(context->cursor[0], base)) {
+        if (!has_class(context->cursor[0], digit_class(base))) {
             exit_with_error(context, LexErrorKind_BadIntLiteral);
             return;
         }
     }
 
+    digits = digit_class(base);
     digits_start = context->cursor;
 
     for (;;) {
-        if (is_digit(context->cursor[0], base)) {
-            context->cursor += 1;
-            handle_normal_character(context);
+        if (has_class(context->cursor[0], digits)) {
+            if (is_exact) {
+                is_exact = scan_digit_run(context, base, &value);
+            } else {
+                skip_class_run(context, digits);
+            }
             continue;
         }
 
@@ -324,12 +754,11 @@ static void lex_number_literal(LexContext* context) {
             }
 
             context->cursor += 1;
-            handle_normal_character(context);
             continue;
         }
 
         /* Junk that's not a digit or underscore. */
-        if (is_id_continue(context->cursor[0])) {
+        if (has_class(context->cursor[0], CharClass_IdContinue)) {
             exit_with_error(context, LexErrorKind_BadIntLiteral);
             return;
         }
@@ -343,12 +772,20 @@ static void lex_number_literal(LexContext* context) {
         return;
     }
 
-    {
+    if (is_exact) {
+        set_integer_token(
+            context,
+            TokenKind_IntLiteral,
+            BigInt_from_uint(context->arena, value)
+        );
+    } else {
         ByteStringRef digits;
         digits.data = (char const*)digits_start;
         digits.size = context->cursor - digits_start;
-        push_integer_token(
-            context, TokenKind_IntLiteral, BigInt_parse(digits, base)
+        set_integer_token(
+            context,
+            TokenKind_IntLiteral,
+            BigInt_parse(context->arena, digits, base)
         );
     }
 }
@@ -357,192 +794,174 @@ static void lex_number_literal(LexContext* context) {
  * Basic
  */
 
-static void lex_bytes_inner(LexContext* context) {
+/* Skip whitespace and comments and lex the next token into `context->token`. */
+static void scan_token(LexContext* context) {
+    uint8_t classes;
+
 loop:
-    sync_token_pos_to_cursor(context);
+    if (context->cursor > context->overflow_cursor) {
+        exit_with_error(context, context->overflow_error);
+    }
+
+    sync_token_start_to_cursor(context);
+
+    classes = char_classes[context->cursor[0]];
 
-    if (is_id_start(context->cursor[0])) {
+    if (classes & CharClass_IdStart) {
         uint8_t const* start;
         TokenKind kind;
         start = context->cursor;
-        while (is_id_continue(context->cursor[0])) {
-            context->cursor += 1;
-            handle_normal_character(context);
-        }
-        kind = id_or_keyword(start, context->cursor - start);
+        skip_class_run(context, CharClass_IdContinue);
+        kind = TokenKind_from_identifier(start, context->cursor - start);
         if (kind == TokenKind_Identifier) {
             StringRef string;
             string.data = start;
             string.size = context->cursor - start;
-            push_string_token(context, TokenKind_Identifier, string);
+            set_string_token(context, TokenKind_Identifier, string);
         } else {
-            push_token(context, kind);
+            set_token(context, kind);
         }
-        goto loop;
+        return;
     }
 
-    if (is_digit(context->cursor[0], 10)) {
+    if (classes & CharClass_DecimalDigit) {
         lex_number_literal(context);
-        goto loop;
+        return;
+    }
+
+    /* Other than whitespace and symbols, only the terminating nul is valid. */
+    if ((classes & (CharClass_Whitespace | CharClass_Symbol)) == 0) {
+        if (context->cursor[0] == 0 && context->cursor == context->limit) {
+            set_token(context, TokenKind_EndOfFile);
+            return;
+        }
+        goto unexpected;
     }
 
     switch (context->cursor[0]) {
-    case ' ':
-        context->cursor += 1;
-        handle_normal_character(context);
+    case ' ': {
+        /* Indentation comes in runs. */
+        size_t run;
+        run = space_run_length(context->cursor, context->limit);
+        context->cursor += run;
         goto loop;
+    }
 
     case '\t':
-        context->cursor += 1;
-        handle_tab(context);
-        goto loop;
-
     case '\r':
-        if (context->cursor[1] == '\n') {
-            context->cursor += 1;
-            handle_crlf_line_terminator(context);
-            goto loop;
-        }
-        /* fallthrough */
     case '\n':
         context->cursor += 1;
-        handle_line_terminator(context);
-        goto loop;
-
-    case 0:
-        /* Check if EOF or embedded nul. */
-        if (context->cursor == context->limit) {
-            push_token(context, TokenKind_EndOfFile);
+        if (context->cursor == context->chunk_end) {
+            sync_token_start_to_cursor(context);
+            set_token(context, TokenKind_EndOfFile);
             return;
         }
-        break;
+        goto loop;
 
     case '.':
         context->cursor += 1;
-        handle_normal_character(context);
         if (context->cursor[0] == '.') {
             if (context->cursor[1] == '.') {
                 context->cursor += 2;
-                handle_normal_character(context);
-                handle_normal_character(context);
-                push_token(context, TokenKind_ClosedRange);
-                goto loop;
+                set_token(context, TokenKind_ClosedRange);
+                return;
             }
             if (context->cursor[1] == '<') {
                 context->cursor += 2;
-                handle_normal_character(context);
-                handle_normal_character(context);
-                push_token(context, TokenKind_HalfOpenRange);
-                goto loop;
+                set_token(context, TokenKind_HalfOpenRange);
+                return;
             }
         }
-        push_token(context, TokenKind_Period);
-        goto loop;
+        set_token(context, TokenKind_Period);
+        return;
 
     case '=':
         context->cursor += 1;
-        handle_normal_character(context);
         switch (context->cursor[0]) {
         case '=':
             context->cursor += 1;
-            handle_normal_character(context);
-            push_token(context, TokenKind_EqualEqual);
+            set_token(context, TokenKind_EqualEqual);
             break;
         case '>':
             context->cursor += 1;
-            handle_normal_character(context);
-            push_token(context, TokenKind_FatArrow);
+            set_token(context, TokenKind_FatArrow);
             break;
         default:
-            push_token(context, TokenKind_Equal);
+            set_token(context, TokenKind_Equal);
             break;
         }
-        goto loop;
+        return;
 
     case '-':
         context->cursor += 1;
-        handle_normal_character(context);
         switch (context->cursor[0]) {
         case '=':
             context->cursor += 1;
-            handle_normal_character(context);
-            push_token(context, TokenKind_MinusEqual);
+            set_token(context, TokenKind_MinusEqual);
             break;
         case '>':
             context->cursor += 1;
-            handle_normal_character(context);
-            push_token(context, TokenKind_ThinArrow);
+            set_token(context, TokenKind_ThinArrow);
             break;
         default:
-            push_token(context, TokenKind_Minus);
+            set_token(context, TokenKind_Minus);
             break;
         }
-        goto loop;
+        return;
 
     case '/':
         switch (context->cursor[1]) {
         case '*':
             lex_block_comment(context);
-            break;
+            goto loop;
         case '/':
             lex_line_comment(context);
-            break;
+            goto loop;
         case '=':
             context->cursor += 2;
-            handle_normal_character(context);
-            handle_normal_character(context);
-            push_token(context, TokenKind_SlashEqual);
-            break;
+            set_token(context, TokenKind_SlashEqual);
+            return;
         default:
             context->cursor += 1;
-            handle_normal_character(context);
-            push_token(context, TokenKind_Slash);
-            break;
+            set_token(context, TokenKind_Slash);
+            return;
         }
-        goto loop;
 
     #define SYMBOL_X(ch, name)                     \
         case ch:                                   \
             context->cursor += 1;                  \
-            handle_normal_character(context);      \
-            push_token(context, TokenKind_##name); \
-            goto loop;
+            set_token(context, TokenKind_##name);  \
+            return;
 
     #define SYMBOL_XE(ch, name)                               \
         case ch:                                              \
             context->cursor += 1;                             \
-            handle_normal_character(context);                 \
             if (context->cursor[0] == '=') {                  \
                 context->cursor += 1;                         \
-                handle_normal_character(context);             \
-                push_token(context, TokenKind_##name##Equal); \
+                set_token(context, TokenKind_##name##Equal);  \
             } else {                                          \
-                push_token(context, TokenKind_##name);        \
+                set_token(context, TokenKind_##name);         \
             }                                                 \
-            goto loop;
+            return;
 
     #define SYMBOL_XXE(ch, name)                                        \
         case ch:                                                        \
             context->cursor += 1;                                       \
-            handle_normal_character(context);                           \
             if (context->cursor[0] == ch) {                             \
                 context->cursor += 1;                                   \
-                handle_normal_character(context);                       \
                 if (context->cursor[0] == '=') {                        \
                     context->cursor += 1;                               \
-                    handle_normal_character(context);                   \
-                    push_token(context, TokenKind_##name##name##Equal); \
+                    set_token(context, TokenKind_##name##name##Equal);  \
                 } else {                                                \
-                    push_token(context, TokenKind_##name##name);        \
+                    set_token(context, TokenKind_##name##name);         \
                 }                                                       \
             } else if (context->cursor[0] == '=') {                     \
                 context->cursor += 1;                                   \
-                handle_normal_character(context);                       \
-                push_token(context, TokenKind_##name##Equal);           \
+                set_token(context, TokenKind_##name##Equal);            \
             } else {                                                    \
-                push_token(context, TokenKind_##name);                  \
+                set_token(context, TokenKind_##name);                   \
             }                                                           \
-            goto loop;
+            return;
 
     SYMBOL_X('(', LeftParen)
     SYMBOL_X(')', RightParen)
@@ -572,9 +991,12 @@ loop:
     #undef SYMBOL_XXE
     }
 
+unexpected:
     {
+        uint8_t const* cursor;
         int32_t ch;
-        ch = utf8_decode(&context->cursor, context->limit);
+        cursor = context->cursor;
+        ch = utf8_decode(&cursor, context->limit);
         if (ch == U_BAD) {
             exit_with_error(context, LexErrorKind_BadEncoding);
         } else {
@@ -585,54 +1007,858 @@ loop:
     }
 }
 
+static void lex_token(LexContext* context) {
+    scan_token(context);
+
+    /* A token running past a limit is not returned. */
+    if (context->cursor > context->overflow_cursor) {
+        exit_with_error(context, context->overflow_error);
+    }
+}
+
 /*
  * Init
  */
 
-void lex_source(
+/* Set up everything but the limits, with the valid UTF-8 prefix of the
+ * source already known. */
+static void init_source(
+    LexContext* context,
+    AstContext* ast,
+    SourceFile const* source,
+    size_t valid_size
+) {
+    TokenKind_init_keywords();
+
+    context->ast = ast;
+    context->data = SourceFile_data(source);
+    context->cursor = context->data;
+    context->limit = context->data + SourceFile_size(source);
+    context->valid_limit = context->data + valid_size;
+    context->chunk_end = context->limit;
+    context->strings = NULL;
+    context->arena = AstContext_arena(ast);
+
+    /* Skip byte order mark. */
+    if (
+        context->cursor[0] == 0xEF
+        && context->cursor[1] == 0xBB
+        && context->cursor[2] == 0xBF
+    ) {
+        context->cursor += 3;
+    }
+}
+
+static void init_context(
+    LexContext* context, AstContext* ast, SourceFile const* source
+) {
+    init_source(
+        context,
+        ast,
+        source,
+        utf8_valid_prefix_size(SourceFile_data(source), SourceFile_size(source))
+    );
+
+    /* The byte order mark is a character, but not part of the first line. */
+    find_limit_overflow(
+        context,
+        context->cursor,
+        context->valid_limit,
+        context->cursor != context->data
+    );
+}
+
+/*
+ * Batch
+ */
+
+static void append_token(LexContext* context) {
+    TokenList* tokens;
+    tokens = &context->tokens;
+
+    if (tokens->size == context->tokens_capacity) {
+        /* Grow both arrays together. 1.5x growth rate, stopping short of
+         * sizes whose offsets array would overflow. */
+        if (
+            context->tokens_capacity
+            > (size_t)-1 / sizeof(uint32_t) / 3 * 2
+        ) {
+            exit_out_of_memory();
+        }
+        context->tokens_capacity += context->tokens_capacity / 2;
+        tokens->kinds = xreallocarray(
+            tokens->kinds, context->tokens_capacity, sizeof(uint8_t)
+        );
+        tokens->offsets = xreallocarray(
+            tokens->offsets, context->tokens_capacity, sizeof(uint32_t)
+        );
+    }
+
+    tokens->kinds[tokens->size] = context->token.kind;
+    tokens->offsets[tokens->size] = context->token.offset;
+    tokens->size += 1;
+
+    if (TokenKind_has_value(context->token.kind)) {
+        tokens->values = ensure_array_capacity(
+            sizeof(TokenValue),
+            tokens->values,
+            &tokens->values_size,
+            &context->values_capacity,
+            1
+        );
+        tokens->values[tokens->values_size] = context->token.value;
+        tokens->values_size += 1;
+    }
+}
+
+/* Lex until EndOfFile into `context->tokens`. Returns false on error, with
+ * the tokens freed. */
+static int lex_tokens(LexContext* context) {
+    /* Guess one token per 4 bytes to avoid most regrowth. */
+    context->tokens_capacity = (context->chunk_end - context->cursor) / 4 + 16;
+    context->tokens.kinds = xallocarray(
+        context->tokens_capacity, sizeof(uint8_t)
+    );
+    context->tokens.offsets = xallocarray(
+        context->tokens_capacity, sizeof(uint32_t)
+    );
+    context->tokens.size = 0;
+    context->tokens.values = NULL;
+    context->tokens.values_size = 0;
+    context->values_capacity = 0;
+
+    if (setjmp(context->exit_jmp_buf) != 0) {
+        TokenList_destroy(&context->tokens);
+        return false;
+    }
+
+    do {
+        lex_token(context);
+        append_token(context);
+    } while (context->token.kind != TokenKind_EndOfFile);
+
+    return true;
+}
+
+void lex_source(LexResult* result, AstContext* ast, SourceFile const* source) {
+    LexContext context;
+
+    init_context(&context, ast, source);
+
+    if (lex_tokens(&context)) {
+        result->is_tokens = true;
+        result->u.tokens = context.tokens;
+    } else {
+        result->is_tokens = false;
+        result->u.error = context.error;
+    }
+}
+
+/*
+ * Parallel
+ *
+ * Large files are split after newlines outside comments, where lexing starts
+ * afresh, and the chunks are lexed on separate threads. Chunks intern names in
+ * their own tables, which are merged into the AstContext afterwards in source
+ * order, so the result is the same as from `lex_source`. Chunks before the
+ * first error are lexed exactly as by `lex_source`, so the first chunk that
+ * fails has the first error.
+ */
+
+/* Smallest chunk worth a thread of its own. Can be lowered from the command
+ * line, say with -DLEX_PARALLEL_MIN_CHUNK_SIZE=64 for fuzzing, to split even
+ * small inputs. */
+#ifndef LEX_PARALLEL_MIN_CHUNK_SIZE
+    #define LEX_PARALLEL_MIN_CHUNK_SIZE (256 * 1024)
+#endif
+
+typedef struct LexChunk {
+    LexContext context;
+    /* Set[AstString] */
+    HashMap strings;
+    Arena arena;
+    int is_tokens;
+    Thread thread;
+} LexChunk;
+
+/* Comment state at `cursor`, found by tracking comment delimiters the same
+ * way the lexer does. Nothing else spans a newline. */
+typedef struct SplitScan {
+    uint8_t const* cursor;
+    uint8_t const* limit;
+    unsigned nesting;
+    int in_line_comment;
+} SplitScan;
+
+/* Position after the first newline outside comments past `target`, or NULL if
+ * there is none. */
+static uint8_t const* next_split_point(
+    SplitScan* scan, uint8_t const* target
+) {
+    uint8_t const* cursor;
+    cursor = scan->cursor;
+
+    for (;;) {
+        cursor += plain_run_length(cursor, scan->limit, &block_comment_stops);
+
+        if (cursor == scan->limit) {
+            scan->cursor = cursor;
+            return NULL;
+        }
+
+        switch (cursor[0]) {
+        case '\n':
+            cursor += 1;
+            scan->in_line_comment = false;
+            if (scan->nesting == 0 && cursor > target) {
+                scan->cursor = cursor;
+                return cursor;
+            }
+            continue;
+        case '\r':
+            scan->in_line_comment = false;
+            break;
+        case '/':
+            if (scan->in_line_comment) {
+                break;
+            }
+            if (cursor[1] == '*') {
+                scan->nesting += 1;
+                cursor += 2;
+                continue;
+            }
+            if (cursor[1] == '/' && scan->nesting == 0) {
+                scan->in_line_comment = true;
+                cursor += 2;
+                continue;
+            }
+            break;
+        case '*':
+            if (!scan->in_line_comment
+                && cursor[1] == '/'
+                && scan->nesting > 0
+            ) {
+                scan->nesting -= 1;
+                cursor += 2;
+                continue;
+            }
+            break;
+        }
+
+        cursor += 1;
+    }
+}
+
+static void lex_chunk(void* arg) {
+    LexChunk* chunk;
+    chunk = arg;
+    chunk->is_tokens = lex_tokens(&chunk->context);
+}
+
+/*
+ * Append the chunk's tokens to `tokens`, which has room for them, replacing
+ * its names with interned ones and copying its big integers to the context.
+ * The chunk's final EndOfFile is dropped unless it is the last chunk.
+ */
+static void merge_chunk(
+    AstContext* ast, TokenList* tokens, LexChunk* chunk, int is_last
+) {
+    TokenList const* chunk_tokens;
+    AstString* names;
+    uint32_t const* string_ids;
+    TokenValue const* value;
+    size_t size;
+    size_t i;
+    uint32_t id;
+
+    chunk_tokens = &chunk->context.tokens;
+
+    /* Interning in order of first use in the chunk, chunk after chunk, adds
+     * new strings in the same order as lexing sequentially. */
+    names = xallocarray(chunk->strings.entries_count + 1, sizeof(AstString));
+    for (id = 1; id <= chunk->strings.entries_count; id += 1) {
+        AstString const* name;
+        name = HashMap_get_key_by_id(&chunk->strings, &string_set_config, id);
+        names[id] = AstContext_add_hashed_string(ast, *name);
+    }
+
+    size = chunk_tokens->size;
+    if (!is_last) {
+        size -= 1;
+    }
+
+    memcpy(tokens->kinds + tokens->size, chunk_tokens->kinds, size);
+    memcpy(
+        tokens->offsets + tokens->size,
+        chunk_tokens->offsets,
+        size * sizeof(uint32_t)
+    );
+    tokens->size += size;
+
+    string_ids = chunk->context.string_ids;
+    value = chunk_tokens->values;
+
+    for (i = 0; i < size; i += 1) {
+        TokenValue* out;
+
+        if (!TokenKind_has_value(chunk_tokens->kinds[i])) {
+            continue;
+        }
+
+        out = &tokens->values[tokens->values_size];
+        tokens->values_size += 1;
+
+        if (chunk_tokens->kinds[i] == TokenKind_Identifier) {
+            out->string = names[*string_ids];
+            string_ids += 1;
+        } else {
+            out->integer = BigInt_copy(AstContext_arena(ast), value->integer);
+        }
+        value += 1;
+    }
+
+    xfree(names);
+}
+
+void lex_source_parallel(
     LexResult* result,
     AstContext* ast,
     SourceFile const* source,
-    LexerConfig const* config
+    unsigned max_threads
 ) {
     LexContext context;
+    LexChunk* chunks;
+    SplitScan scan;
+    TokenList tokens;
+    uint8_t const* start;
+    size_t size;
+    size_t count;
+    size_t values_size;
+    size_t i;
+
+    size = SourceFile_size(source);
+    count = size / LEX_PARALLEL_MIN_CHUNK_SIZE;
+    if (count > max_threads) {
+        count = max_threads;
+    }
+
+    if (count <= 1) {
+        lex_source(result, ast, source);
+        return;
+    }
 
-    context.ast = ast;
-    context.cursor = SourceFile_data(source);
-    context.limit = context.cursor + SourceFile_size(source);
+    /* Also builds the keyword table before any chunk thread reads it. */
+    init_context(&context, ast, source);
 
-    context.cursor_pos.line = 1;
-    context.cursor_pos.column = 1;
-    context.total_characters = 0;
+    scan.cursor = context.cursor;
+    scan.limit = context.valid_limit;
+    scan.nesting = 0;
+    scan.in_line_comment = false;
 
-    context.tokens_data = NULL;
-    context.tokens_size = 0;
-    context.tokens_capacity = 0;
+    chunks = xallocarray(count, sizeof(LexChunk));
+    start = context.cursor;
 
-    if (config == NULL) {
-        context.config.tab_stop = 8;
-    } else {
-        context.config = *config;
+    for (i = 0; i < count; i += 1) {
+        LexChunk* chunk;
+        uint8_t const* end = NULL;
+
+        if (i + 1 < count) {
+            end = next_split_point(
+                &scan, context.data + size / count * (i + 1)
+            );
+        }
+        if (end == NULL || end == context.limit) {
+            /* Too few split points. This is the last chunk. */
+            end = context.limit;
+            count = i + 1;
+        }
+
+        chunk = &chunks[i];
+        chunk->context = context;
+        chunk->context.cursor = start;
+        chunk->context.chunk_end = end;
+        chunk->context.strings = &chunk->strings;
+        chunk->context.string_ids = NULL;
+        chunk->context.string_ids_size = 0;
+        chunk->context.string_ids_capacity = 0;
+        chunk->context.arena = &chunk->arena;
+        HashMap_init(&chunk->strings, &string_set_config);
+        Arena_init(&chunk->arena);
+
+        start = end;
     }
 
-    /* Skip byte order mark. */
-    if (
-        context.cursor[0] == 0xEF
-        && context.cursor[1] == 0xBB
-        && context.cursor[2] == 0xBF
+    /* Lex the first chunk on this thread. */
+    for (i = 1; i < count; i += 1) {
+        Thread_start(&chunks[i].thread, lex_chunk, &chunks[i]);
+    }
+    lex_chunk(&chunks[0]);
+    for (i = 1; i < count; i += 1) {
+        Thread_join(&chunks[i].thread);
+    }
+
+    result->is_tokens = true;
+    for (i = 0; i < count; i += 1) {
+        if (!chunks[i].is_tokens) {
+            result->is_tokens = false;
+            result->u.error = chunks[i].context.error;
+            break;
+        }
+    }
+
+    if (result->is_tokens) {
+        tokens.size = 0;
+        values_size = 0;
+        for (i = 0; i < count; i += 1) {
+            tokens.size += chunks[i].context.tokens.size;
+            values_size += chunks[i].context.tokens.values_size;
+        }
+        /* Every chunk but the last ends in a dropped EndOfFile. */
+        tokens.size -= count - 1;
+
+        tokens.kinds = xallocarray(tokens.size, sizeof(uint8_t));
+        tokens.offsets = xallocarray(tokens.size, sizeof(uint32_t));
+        tokens.values = xallocarray(values_size, sizeof(TokenValue));
+        tokens.size = 0;
+        tokens.values_size = 0;
+
+        for (i = 0; i < count; i += 1) {
+            merge_chunk(ast, &tokens, &chunks[i], i + 1 == count);
+        }
+
+        result->u.tokens = tokens;
+    }
+
+    for (i = 0; i < count; i += 1) {
+        if (chunks[i].is_tokens) {
+            TokenList_destroy(&chunks[i].context.tokens);
+        }
+        HashMap_destroy(&chunks[i].strings);
+        Arena_destroy(&chunks[i].arena);
+        xfree(chunks[i].context.string_ids);
+    }
+    xfree(chunks);
+}
+
+/*
+ * Incremental
+ *
+ * Tokens before the edit are kept and lexing restarts at the start of the
+ * last token before it, where nothing carries over from earlier text. Once a
+ * token starts where an old token started after the edit, the text from
+ * there on is the same, so the remaining old tokens are kept too. Limits and
+ * encoding only need checking near the edit, since the old text was lexed
+ * without error.
+ */
+
+/* Bytes past the end of a token that lexing it may look at, as in `..` not
+ * followed by `.` or `<`. */
+#define TOKEN_LOOKAHEAD 2
+
+/* Start of the line holding the byte before `offset`. */
+static uint8_t const* edited_line_start(
+    LexContext const* context, uint32_t offset
+) {
+    uint8_t const* cursor;
+
+    cursor = context->data + offset;
+
+    /* Removing text after a CR can join it with an LF. */
+    if (cursor > context->cursor && cursor[-1] == '\r') {
+        cursor -= 1;
+    }
+
+    while (
+        cursor > context->cursor && cursor[-1] != '\r' && cursor[-1] != '\n'
     ) {
-        context.cursor += 3;
-        context.total_characters += 1;
+        cursor -= 1;
     }
 
-    if (setjmp(context.exit_jmp_buf) == 0) {
-        lex_bytes_inner(&context);
-        result->is_tokens = true;
-        result->u.tokens.data = context.tokens_data;
-        result->u.tokens.size = context.tokens_size;
+    return cursor;
+}
+
+/* End of the line holding `cursor`, including its terminator. */
+static uint8_t const* edited_line_end(
+    LexContext const* context, uint8_t const* cursor
+) {
+    while (cursor < context->limit && cursor[0] != '\r' && cursor[0] != '\n') {
+        cursor += 1;
+    }
+
+    if (cursor[0] == '\r' && cursor[1] == '\n') {
+        cursor += 2;
+    } else if (cursor < context->limit) {
+        cursor += 1;
+    }
+
+    return cursor;
+}
+
+/* Length of the valid UTF-8 prefix of the edited source. Only the characters
+ * around the new text need checking. */
+static size_t edited_valid_size(
+    SourceFile const* source, SourceEdit const* edit
+) {
+    uint8_t const* data;
+    size_t size;
+    size_t start;
+    size_t end;
+
+    data = SourceFile_data(source);
+    size = SourceFile_size(source);
+
+    /* Back to the character the edit may have cut. */
+    start = edit->offset;
+    while (start > 0 && (data[start - 1] & 0xC0) == 0x80) {
+        start -= 1;
+    }
+    if (start > 0) {
+        start -= 1;
+    }
+
+    end = edit->offset + edit->text.size;
+    while (end < size && (data[end] & 0xC0) == 0x80) {
+        end += 1;
+    }
+
+    start += utf8_valid_prefix_size(data + start, end - start);
+    return start == end ? size : start;
+}
+
+/* Lex from `context->cursor` into `context->tokens` until the tokens line up
+ * with `tokens` again after the edit, storing the index of the first old
+ * token kept in `resync`. Returns false on error, with the new tokens freed.
+ * Kept apart from `relex_source` so none of its locals live across the
+ * setjmp. */
+static int relex_tokens(
+    LexContext* context,
+    TokenList const* tokens,
+    size_t kept,
+    uint32_t edit_end,
+    uint32_t delta,
+    size_t* resync
+) {
+    size_t index;
+
+    context->tokens_capacity = 16;
+    context->tokens.kinds = xallocarray(
+        context->tokens_capacity, sizeof(uint8_t)
+    );
+    context->tokens.offsets = xallocarray(
+        context->tokens_capacity, sizeof(uint32_t)
+    );
+    context->tokens.size = 0;
+    context->tokens.values = NULL;
+    context->tokens.values_size = 0;
+    context->values_capacity = 0;
+
+    if (setjmp(context->exit_jmp_buf) != 0) {
+        TokenList_destroy(&context->tokens);
+        return false;
+    }
+
+    index = kept;
+
+    for (;;) {
+        lex_token(context);
+
+        /* Lexing must go on to an overflow, which is an error. */
+        if (
+            context->token.offset >= edit_end
+            && context->overflow_cursor == context->limit
+        ) {
+            uint32_t old_offset;
+            old_offset = context->token.offset - delta;
+
+            while (tokens->offsets[index] < old_offset) {
+                index += 1;
+            }
+            if (tokens->offsets[index] == old_offset) {
+                assert(tokens->kinds[index] == context->token.kind);
+                break;
+            }
+        }
+
+        append_token(context);
+
+        if (context->token.kind == TokenKind_EndOfFile) {
+            index = tokens->size;
+            break;
+        }
+    }
+
+    *resync = index;
+    return true;
+}
+
+void relex_source(
+    LexResult* result,
+    AstContext* ast,
+    SourceFile const* source,
+    TokenList* tokens,
+    SourceEdit const* edit
+) {
+    LexContext context;
+    uint32_t edit_end;
+    uint32_t delta;
+    size_t kept;
+    size_t kept_values;
+    size_t resync;
+    size_t resync_values;
+    size_t tail;
+    size_t tail_values;
+    size_t i;
+
+    /* Files this small can only be over the line length limit, and only in
+     * the edited lines. */
+    if (SourceFile_size(source) < MAX_LINES_PER_FILE) {
+        uint8_t const* line_start;
+        uint8_t const* line_end;
+
+        init_source(&context, ast, source, edited_valid_size(source, edit));
+
+        line_start = edited_line_start(&context, edit->offset);
+        line_end = edited_line_end(
+            &context, context.data + edit->offset + edit->text.size
+        );
+        if (line_end > context.valid_limit) {
+            line_end = context.valid_limit;
+        }
+        find_limit_overflow(&context, line_start, line_end, 0);
     } else {
-        xfree(context.tokens_data);
+        init_context(&context, ast, source);
+    }
+
+    /* Find the tokens starting far enough before the edit that lexing them
+     * looked at no edited bytes, except maybe the last one. */
+    {
+        size_t low = 0;
+        size_t high = tokens->size;
+
+        while (low < high) {
+            size_t middle;
+            middle = low + (high - low) / 2;
+            if (
+                (size_t)tokens->offsets[middle] + TOKEN_LOOKAHEAD
+                <= edit->offset
+            ) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+
+        kept = low;
+    }
+
+    if (kept > 0) {
+        kept -= 1;
+        context.cursor = context.data + tokens->offsets[kept];
+    }
+
+    edit_end = edit->offset + edit->text.size;
+    delta = edit->text.size - edit->removed_size;
+
+    if (!relex_tokens(&context, tokens, kept, edit_end, delta, &resync)) {
+        TokenList_destroy(tokens);
         result->is_tokens = false;
         result->u.error = context.error;
+        return;
+    }
+
+    /* Splice the new tokens in place of the old ones between `kept` and
+     * `resync`, moving the rest by the size change of the edit. Values are
+     * counted from the end, which is moved anyway. */
+    tail = tokens->size - resync;
+    tail_values = 0;
+    for (i = resync; i < tokens->size; i += 1) {
+        tail_values += TokenKind_has_value(tokens->kinds[i]);
+    }
+    resync_values = tokens->values_size - tail_values;
+
+    kept_values = resync_values;
+    for (i = kept; i < resync; i += 1) {
+        kept_values -= TokenKind_has_value(tokens->kinds[i]);
     }
+
+    if (context.tokens.size > resync - kept) {
+        tokens->kinds = xreallocarray(
+            tokens->kinds, kept + context.tokens.size + tail, sizeof(uint8_t)
+        );
+        tokens->offsets = xreallocarray(
+            tokens->offsets,
+            kept + context.tokens.size + tail,
+            sizeof(uint32_t)
+        );
+    }
+    if (context.tokens.values_size > resync_values - kept_values) {
+        tokens->values = xreallocarray(
+            tokens->values,
+            kept_values + context.tokens.values_size + tail_values,
+            sizeof(TokenValue)
+        );
+    }
+
+    memmove(
+        tokens->kinds + kept + context.tokens.size,
+        tokens->kinds + resync,
+        tail
+    );
+    memmove(
+        tokens->offsets + kept + context.tokens.size,
+        tokens->offsets + resync,
+        tail * sizeof(uint32_t)
+    );
+    if (tail_values > 0) {
+        memmove(
+            tokens->values + kept_values + context.tokens.values_size,
+            tokens->values + resync_values,
+            tail_values * sizeof(TokenValue)
+        );
+    }
+
+    memcpy(
+        tokens->kinds + kept, context.tokens.kinds, context.tokens.size
+    );
+    memcpy(
+        tokens->offsets + kept,
+        context.tokens.offsets,
+        context.tokens.size * sizeof(uint32_t)
+    );
+    if (context.tokens.values_size > 0) {
+        memcpy(
+            tokens->values + kept_values,
+            context.tokens.values,
+            context.tokens.values_size * sizeof(TokenValue)
+        );
+    }
+
+    tokens->size = kept + context.tokens.size + tail;
+    tokens->values_size = kept_values + context.tokens.values_size
+        + tail_values;
+
+    for (i = tokens->size - tail; i < tokens->size; i += 1) {
+        tokens->offsets[i] += delta;
+    }
+
+    TokenList_destroy(&context.tokens);
+
+    result->is_tokens = true;
+    result->u.tokens = *tokens;
+}
+
+/*
+ * Streaming
+ */
+
+struct Lexer {
+    LexContext context;
+
+    /* Ring buffer of tokens lexed but not consumed yet. */
+    Token lookahead[LEXER_MAX_LOOKAHEAD];
+    size_t lookahead_start;
+    size_t lookahead_size;
+
+    /* Set once EndOfFile is lexed, after which `context.token` is kept. */
+    int is_at_end;
+
+    /* Set when lexing failed after the buffered tokens. */
+    int has_error;
+};
+
+Lexer* Lexer_new(AstContext* ast, SourceFile const* source) {
+    Lexer* lexer;
+
+    lexer = xmalloc(sizeof(Lexer));
+    init_context(&lexer->context, ast, source);
+    lexer->lookahead_start = 0;
+    lexer->lookahead_size = 0;
+    lexer->is_at_end = false;
+    lexer->has_error = false;
+
+    return lexer;
+}
+
+void Lexer_delete(Lexer* lexer) {
+    xfree(lexer);
+}
+
+/* Fill the lookahead buffer, stopping early at an error. Past the end of
+ * file, the EndOfFile token is repeated. Filling it all at once keeps the
+ * setjmp cost off each token. */
+static void fill_lookahead(Lexer* lexer) {
+    LexContext* context;
+    context = &lexer->context;
+
+    if (setjmp(context->exit_jmp_buf) != 0) {
+        lexer->has_error = true;
+        return;
+    }
+
+    while (lexer->lookahead_size < LEXER_MAX_LOOKAHEAD) {
+        size_t index;
+
+        if (!lexer->is_at_end) {
+            lex_token(context);
+            lexer->is_at_end = context->token.kind == TokenKind_EndOfFile;
+        }
+
+        index = (lexer->lookahead_start + lexer->lookahead_size)
+            % LEXER_MAX_LOOKAHEAD;
+        lexer->lookahead[index] = context->token;
+        lexer->lookahead_size += 1;
+    }
+}
+
+int Lexer_peek(Lexer* lexer, size_t n, Token* out_token) {
+    assert(n < LEXER_MAX_LOOKAHEAD);
+
+    if (n >= lexer->lookahead_size && !lexer->has_error) {
+        fill_lookahead(lexer);
+    }
+
+    if (n >= lexer->lookahead_size) {
+        return false;
+    }
+
+    *out_token =
+        lexer->lookahead[(lexer->lookahead_start + n) % LEXER_MAX_LOOKAHEAD];
+    return true;
+}
+
+int Lexer_next(Lexer* lexer, Token* out_token) {
+    if (!Lexer_peek(lexer, 0, out_token)) {
+        return false;
+    }
+
+    lexer->lookahead_start =
+        (lexer->lookahead_start + 1) % LEXER_MAX_LOOKAHEAD;
+    lexer->lookahead_size -= 1;
+    return true;
+}
+
+int Lexer_check_known_error(Lexer* lexer) {
+    Token token;
+
+    if (
+        lexer->context.valid_limit == lexer->context.limit
+        && lexer->context.overflow_cursor == lexer->context.limit
+    ) {
+        return true;
+    }
+
+    /* Lex up to the error, which may come before the one found up front. */
+    while (Lexer_next(lexer, &token)) {
+        if (token.kind == TokenKind_EndOfFile) {
+            break;
+        }
+    }
+
+    assert(lexer->has_error);
+    return false;
+}
+
+LexError const* Lexer_error(Lexer const* lexer) {
+    assert(lexer->has_error);
+    return &lexer->context.error;
 }
@@ -8,10 +8,6 @@
 
 #include <setjmp.h>
 
-typedef struct LexerConfig {
-    uint32_t tab_stop;
-} LexerConfig;
-
 typedef struct LexResult {
     int is_tokens;
     union {
@@ -20,11 +16,68 @@ typedef struct LexResult {
     } u;
 } LexResult;
 
-void lex_source(
+/**
+ * Split a source file into tokens. Token and error positions are byte offsets
+ * into the file, which `SourceFile_get_pos` turns into lines and columns.
+ */
+void lex_source(LexResult* result, AstContext* ast, SourceFile const* source);
+
+/**
+ * Same as `lex_source`, but large files are split into chunks lexed on up to
+ * `max_threads` threads.
+ */
+void lex_source_parallel(
+    LexResult* result,
+    AstContext* ast,
+    SourceFile const* source,
+    unsigned max_threads
+);
+
+/**
+ * Update `tokens`, lexed without error from a source before `edit`, for
+ * `source`, the result of `AstContext_source_from_edit`. Only tokens from the
+ * last token boundary before the edit until the tokens line up with the old
+ * ones again are lexed. The updated tokens are moved to `result`, which is
+ * the same as from `lex_source`. On error, `tokens` is destroyed.
+ */
+void relex_source(
     LexResult* result,
     AstContext* ast,
     SourceFile const* source,
-    LexerConfig const* config
+    TokenList* tokens,
+    SourceEdit const* edit
 );
 
+/** Number of tokens `Lexer_peek` can see ahead. */
+#define LEXER_MAX_LOOKAHEAD 4
+
+/**
+ * Lexer producing tokens on demand, so memory use doesn't depend on the
+ * file size. Tokens are the same as from `lex_source`. After the end of
+ * file, it keeps returning EndOfFile tokens.
+ */
+typedef struct Lexer Lexer;
+
+Lexer* Lexer_new(AstContext* ast, SourceFile const* source);
+void Lexer_delete(Lexer* lexer);
+
+/** Token `n` places after the next one, with `n < LEXER_MAX_LOOKAHEAD`.
+ * Returns false if lexing fails before it, see `Lexer_error`. */
+int Lexer_peek(Lexer* lexer, size_t n, Token* out_token);
+
+/** Consume the next token. Returns false if lexing fails, see
+ * `Lexer_error`. */
+int Lexer_next(Lexer* lexer, Token* out_token);
+
+/**
+ * Invalid UTF-8 and size limits are checked for the whole file when the
+ * Lexer is made. If they failed, lex up to the first error and return false,
+ * see `Lexer_error`, so it can be reported ahead of syntax errors. Other lex
+ * errors are only found when the tokens before them are consumed.
+ */
+int Lexer_check_known_error(Lexer* lexer);
+
+/** Error that stopped the lexer. */
+LexError const* Lexer_error(Lexer const* lexer);
+
 #endif
@@ -1,23 +1,102 @@
 #include "src/parsing/lex.h"
 #include "src/support/malloc.h"
 
+#include <stdlib.h>
+
+/* Reused across inputs to avoid going back to the system allocator. */
+static AstContext* ast = NULL;
+
+/* Re-lex after replacing a range of the input with another part of it, and
+ * compare with lexing the edited source from scratch. */
+static void check_relex(SourceFile const* source, TokenList* tokens) {
+    uint8_t const* data;
+    size_t size;
+    SourceEdit edit;
+    size_t text_offset;
+    SourceFile const* edited;
+    LexResult full_result;
+    LexResult relex_result;
+
+    data = SourceFile_data(source);
+    size = SourceFile_size(source);
+
+    if (size < 4) {
+        TokenList_destroy(tokens);
+        return;
+    }
+
+    edit.offset = (data[0] | (data[1] << 8)) % (size + 1);
+    edit.removed_size = data[2] % (size - edit.offset + 1);
+    text_offset = data[3] % size;
+    edit.text.data = data + text_offset;
+    edit.text.size = data[1] % (size - text_offset + 1);
+
+    edited = AstContext_source_from_edit(ast, source, &edit);
+
+    lex_source(&full_result, ast, edited);
+    relex_source(&relex_result, ast, edited, tokens, &edit);
+
+    if (full_result.is_tokens != relex_result.is_tokens) {
+        abort();
+    }
+
+    if (full_result.is_tokens) {
+        if (!TokenList_equal(&full_result.u.tokens, &relex_result.u.tokens)) {
+            abort();
+        }
+        TokenList_destroy(&full_result.u.tokens);
+        TokenList_destroy(&relex_result.u.tokens);
+    } else if (
+        full_result.u.error.offset != relex_result.u.error.offset
+        || full_result.u.error.kind != relex_result.u.error.kind
+    ) {
+        abort();
+    }
+}
+
+/* Lex in chunks and compare with lexing the whole source. Inputs are only
+ * split when built with a small LEX_PARALLEL_MIN_CHUNK_SIZE. */
+static void check_parallel(SourceFile const* source, LexResult const* full) {
+    LexResult parallel;
+
+    lex_source_parallel(&parallel, ast, source, 4);
+
+    if (full->is_tokens != parallel.is_tokens) {
+        abort();
+    }
+
+    if (full->is_tokens) {
+        if (!TokenList_equal(&full->u.tokens, &parallel.u.tokens)) {
+            abort();
+        }
+        TokenList_destroy(&parallel.u.tokens);
+    } else if (
+        full->u.error.offset != parallel.u.error.offset
+        || full->u.error.kind != parallel.u.error.kind
+    ) {
+        abort();
+    }
+}
+
 int LLVMFuzzerTestOneInput(uint8_t const* data, size_t size) {
-    AstContext* ast;
     SourceFile const* source;
     StringRef name = STATIC_STRING_REF("fuzz.zn");
     LexResult lex_result;
 
-    ast = AstContext_new();
+    if (ast == NULL) {
+        ast = AstContext_new();
+    } else {
+        AstContext_reset(ast);
+    }
 
     source = AstContext_source_from_bytes(ast, name, data, size);
 
-    lex_source(&lex_result, ast, source, NULL);
+    lex_source(&lex_result, ast, source);
+    check_parallel(source, &lex_result);
 
     if (lex_result.is_tokens) {
-        xfree(lex_result.u.tokens.data);
+        check_relex(source, &lex_result.u.tokens);
     }
 
-    AstContext_delete(ast);
-
     return 0;
 }
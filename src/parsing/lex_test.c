@@ -0,0 +1,289 @@
+#undef NDEBUG
+
+#include "src/parsing/lex.h"
+#include "src/support/array_writer.h"
+#include "src/support/malloc.h"
+
+#include <assert.h>
+#include <string.h>
+
+/* Enough for 4 chunks at the default LEX_PARALLEL_MIN_CHUNK_SIZE, well under
+ * MAX_CHARACTERS_PER_FILE. */
+#define SOURCE_SIZE (1536 * 1024)
+
+#define THREAD_COUNT 4
+
+static char const* const pieces[] = {
+    "def", "let", "class", "interface", "import", "mut", "out",
+    "0", "42", "0x7FFF_FFFF", "0b1010_0101", "1_000_000",
+    "123456789012345678901234567890",
+    "0xFFFF_FFFF_FFFF_FFFF_FFFF_FFFF_FFFF_FFFF",
+    "(", ")", "{", "}", "[", "]", ";", ",", ".", ":", "@",
+    "=", "==", "+=", "<<=", ">>", "&&", "||=", "^^", "->", "=>", "!", "~",
+    "/* a * b / c */", "/* nested /* block */\n comment */",
+    "/*\tcaf\xC3\xA9 */", "// line comment\n",
+    "// \xC3\xBCn\xC3\xAF" "code\r\n", "\t", "\r\n", "\n"
+};
+
+#define PIECE_COUNT (sizeof(pieces) / sizeof(pieces[0]))
+
+static uint64_t random_state = 0x9E3779B97F4A7C15u;
+
+static uint64_t random_next(void) {
+    /* xorshift64 */
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+/* Tokens of every kind, comments across lines, and names repeated all over
+ * the file, so chunks intern the same strings. */
+static void generate_source(ArrayWriter* writer) {
+    size_t line_pieces = 0;
+
+    while (writer->size < SOURCE_SIZE) {
+        uint64_t choice;
+        choice = random_next() % (PIECE_COUNT + 8);
+
+        if (choice < PIECE_COUNT) {
+            Writer_write_zstr(&writer->base, pieces[choice]);
+        } else {
+            Writer_write_zstr(&writer->base, "name");
+            Writer_write_uint(&writer->base, random_next() % 500, 10);
+        }
+        Writer_write_zstr(&writer->base, " ");
+
+        line_pieces += 1;
+        if (line_pieces == 16) {
+            Writer_write_zstr(&writer->base, "\n");
+            line_pieces = 0;
+        }
+    }
+}
+
+/* Lex `data` serially and in chunks, and check both give the same result.
+ * Returns whether lexing succeeded, with the error in `error` if not. */
+static int check_parallel(
+    AstContext* ast, uint8_t const* data, size_t size, LexError* error
+) {
+    StringRef name = STATIC_STRING_REF("lex_test.zn");
+    SourceFile const* source;
+    LexResult serial;
+    LexResult parallel;
+
+    source = AstContext_source_from_bytes(ast, name, data, size);
+
+    lex_source(&serial, ast, source);
+    lex_source_parallel(&parallel, ast, source, THREAD_COUNT);
+
+    assert(serial.is_tokens == parallel.is_tokens);
+
+    if (!serial.is_tokens) {
+        assert(serial.u.error.offset == parallel.u.error.offset);
+        assert(serial.u.error.kind == parallel.u.error.kind);
+        *error = serial.u.error;
+        return false;
+    }
+
+    assert(TokenList_equal(&serial.u.tokens, &parallel.u.tokens));
+    TokenList_destroy(&serial.u.tokens);
+    TokenList_destroy(&parallel.u.tokens);
+    return true;
+}
+
+typedef struct RelexCase {
+    char const* before;
+    uint32_t offset;
+    uint32_t removed_size;
+    char const* text;
+} RelexCase;
+
+/* Edits of small sources, relexed and compared with lexing the edited
+ * source from scratch. */
+static RelexCase const relex_cases[] = {
+    /* Inside a token, splitting it, and joining two. */
+    { "let abc = 12345;", 5, 1, "x" },
+    { "let abc = 12345;", 12, 0, " " },
+    { "let ab cd = 1;", 6, 1, "" },
+    /* Inside a block comment, opening, and closing one. */
+    { "a /* b c */ d e", 7, 1, "xyz" },
+    { "a /* b /* c */ d */ e", 7, 2, "" },
+    { "a b c d e", 4, 0, "/*" },
+    { "a b */ c", 0, 0, "/* " },
+    /* At the end of the file. */
+    { "a b c", 5, 0, " d" },
+    { "a b c", 4, 1, "" },
+    { "a b c", 5, 0, "// comment" },
+    { "", 0, 0, "a" },
+    /* Adding and removing line breaks, also in a line comment. */
+    { "a b\nc d", 1, 0, "\n" },
+    { "a b\nc d", 3, 1, "" },
+    { "a // b\nc d", 4, 0, "\r\n" },
+    { "a // b\nc d", 6, 1, " " },
+    /* Into an error. */
+    { "a 0x1F b", 4, 0, "_" },
+    { "a b c", 2, 0, "\xFF" }
+};
+
+static void check_relex(AstContext* ast) {
+    StringRef name = STATIC_STRING_REF("lex_test.zn");
+    size_t i;
+
+    for (i = 0; i < sizeof(relex_cases) / sizeof(relex_cases[0]); i += 1) {
+        RelexCase const* relex_case = &relex_cases[i];
+        SourceFile const* source;
+        SourceFile const* edited;
+        SourceEdit edit;
+        LexResult before;
+        LexResult full;
+        LexResult relexed;
+
+        source = AstContext_source_from_bytes(
+            ast, name, relex_case->before, strlen(relex_case->before)
+        );
+        lex_source(&before, ast, source);
+        assert(before.is_tokens);
+
+        edit.offset = relex_case->offset;
+        edit.removed_size = relex_case->removed_size;
+        edit.text = StringRef_from_zstr(relex_case->text);
+        edited = AstContext_source_from_edit(ast, source, &edit);
+
+        lex_source(&full, ast, edited);
+        relex_source(&relexed, ast, edited, &before.u.tokens, &edit);
+
+        assert(full.is_tokens == relexed.is_tokens);
+        if (full.is_tokens) {
+            assert(TokenList_equal(&full.u.tokens, &relexed.u.tokens));
+            TokenList_destroy(&full.u.tokens);
+            TokenList_destroy(&relexed.u.tokens);
+        } else {
+            assert(full.u.error.offset == relexed.u.error.offset);
+            assert(full.u.error.kind == relexed.u.error.kind);
+        }
+    }
+}
+
+/* Peek every lookahead depth at every token of short inputs, going a few
+ * tokens past the end, and compare with `lex_source`. */
+static void check_lexer_peek(AstContext* ast) {
+    static char const* const inputs[] = {
+        "", "a", "a b", "a + 1", "def f() {}", "a\nb\nc\nd\ne"
+    };
+    StringRef name = STATIC_STRING_REF("lex_test.zn");
+    size_t i;
+
+    for (i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i += 1) {
+        SourceFile const* source;
+        LexResult full;
+        Lexer* lexer;
+        Token token;
+        size_t position;
+        size_t n;
+
+        source = AstContext_source_from_bytes(
+            ast, name, inputs[i], strlen(inputs[i])
+        );
+        lex_source(&full, ast, source);
+        assert(full.is_tokens);
+
+        /* A deep peek first, before shallower ones fill the buffer. */
+        for (n = 1; n < LEXER_MAX_LOOKAHEAD; n += 1) {
+            size_t index = n < full.u.tokens.size ? n : full.u.tokens.size - 1;
+
+            lexer = Lexer_new(ast, source);
+            assert(Lexer_peek(lexer, n, &token));
+            assert(token.kind == full.u.tokens.kinds[index]);
+            Lexer_delete(lexer);
+        }
+
+        lexer = Lexer_new(ast, source);
+
+        for (position = 0; position < full.u.tokens.size + 3; position += 1) {
+            for (n = 0; n < LEXER_MAX_LOOKAHEAD; n += 1) {
+                size_t index = position + n;
+                if (index >= full.u.tokens.size) {
+                    /* EndOfFile repeats. */
+                    index = full.u.tokens.size - 1;
+                }
+
+                assert(Lexer_peek(lexer, n, &token));
+                assert(token.kind == full.u.tokens.kinds[index]);
+                assert(token.offset == full.u.tokens.offsets[index]);
+            }
+
+            assert(Lexer_next(lexer, &token));
+        }
+
+        Lexer_delete(lexer);
+        TokenList_destroy(&full.u.tokens);
+    }
+
+    /* Peeking past an error fails with that error, after the tokens
+     * before it. */
+    {
+        SourceFile const* source;
+        Lexer* lexer;
+        Token token;
+
+        source = AstContext_source_from_bytes(ast, name, "a \xFF", 3);
+        lexer = Lexer_new(ast, source);
+
+        assert(Lexer_peek(lexer, 0, &token));
+        assert(token.kind == TokenKind_Identifier);
+        assert(!Lexer_peek(lexer, 1, &token));
+        assert(Lexer_error(lexer)->offset == 2);
+        assert(Lexer_next(lexer, &token));
+        assert(!Lexer_next(lexer, &token));
+
+        Lexer_delete(lexer);
+    }
+}
+
+int main(void) {
+    AstContext* ast;
+    ArrayWriter writer;
+    uint8_t* data;
+    size_t size;
+    LexError error;
+    size_t late;
+    size_t early;
+
+    ast = AstContext_new();
+    ArrayWriter_init(&writer);
+
+    check_lexer_peek(ast);
+    check_relex(ast);
+
+    generate_source(&writer);
+    size = writer.size;
+    data = xmalloc(size);
+
+    memcpy(data, writer.data, size);
+    assert(check_parallel(ast, data, size, &error));
+
+    /* Errors in the last chunk, then also in the second: the first one in
+     * the file is reported, whichever chunk finished first. */
+    late = size - size / 8;
+    early = size / 3;
+
+    data[late] = 0xFF;
+    assert(!check_parallel(ast, data, size, &error));
+    assert(error.offset <= late);
+
+    data[early] = 0xFF;
+    assert(!check_parallel(ast, data, size, &error));
+    assert(error.offset <= early);
+
+    /* A comment opened in the middle, unless it lands in a line comment,
+     * swallows every split point after it. */
+    memcpy(data, writer.data, size);
+    memcpy(data + size / 2, "/*", 2);
+    check_parallel(ast, data, size, &error);
+
+    xfree(data);
+    ArrayWriter_destroy(&writer);
+    AstContext_delete(ast);
+    return 0;
+}
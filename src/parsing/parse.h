@@ -3,12 +3,14 @@
 
 #include "src/ast/context.h"
 #include "src/ast/nodes.h"
+#include "src/parsing/lex.h"
 #include "src/parsing/token.h"
 #include "src/support/string_ref.h"
 
 typedef enum ParseResultKind {
     ParseResultKind_Success,
     ParseResultKind_ParseError,
+    ParseResultKind_LexError,
     ParseResultKind_YaccError
 } ParseResultKind;
 
@@ -27,19 +29,25 @@ typedef enum SyntaxCategory {
 
 typedef struct ParseError {
     SyntaxCategory expected_category;
-    SourcePos actual_token_pos;
+    uint32_t actual_token_offset;
     TokenKind actual_token_kind;
 } ParseError;
 
 typedef struct ParseResult {
     ParseResultKind kind;
     union {
-        Item* item;
+        Module module;
         ParseError parse_error;
+        LexError lex_error;
         ByteStringRef yacc_error;
     } u;
 } ParseResult;
 
-void parse(ParseResult* result, AstContext* context, TokenList const* tokens);
+/**
+ * Parse tokens pulled from `lexer` as they are needed. Invalid UTF-8 and
+ * overlong files are reported before any syntax error, but other lex errors
+ * only if no syntax error comes before them.
+ */
+void parse(ParseResult* result, AstContext* context, Lexer* lexer);
 
 #endif
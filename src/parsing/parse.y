@@ -12,14 +12,22 @@
     #include "src/parsing/parse.h"
 
     typedef struct ParseContext {
-        TokenList const* tokens;
-        size_t token_index;
+        Lexer* lexer;
+        /* Set when the lexer failed, which ends the token stream early. */
+        int lex_failed;
         AstContext* ast;
         ParseResult* result;
+        /* Items parsed so far. */
+        Module module;
     } ParseContext;
 
-    /* Our location type is the token index. */
-    #define YYLTYPE uint32_t
+    /* Our location type is the token, without its value. */
+    typedef struct ParseLocation {
+        uint32_t offset;
+        TokenKind kind;
+    } ParseLocation;
+
+    #define YYLTYPE ParseLocation
 
     /* Set the location of non-terminals to the first token. */
     #define YYLLOC_DEFAULT(loc, rhs, n) \
@@ -33,35 +41,34 @@
     typedef YYSTYPE YaccValue;
 
     static void yyerror(
-        uint32_t* loc,
+        ParseLocation* loc,
         ParseContext* context,
         char const* message
     );
 
     static int yylex(
         YaccValue* value,
-        uint32_t* loc,
+        ParseLocation* loc,
         ParseContext* context
     );
 
-    static void success(ParseContext* context, Item* item);
+    static void success(ParseContext* context);
     static void expected(
-        ParseContext* context, SyntaxCategory category, uint32_t token_index
+        ParseContext* context, SyntaxCategory category, ParseLocation token
     );
 
-    #define SUCCESS(result) success(context, (result))
+    #define SUCCESS() success(context)
 
-    #define EXPECTED(category, index)                              \
+    #define EXPECTED(category, token)                              \
         do {                                                       \
-            expected(context, SyntaxCategory_##category, (index)); \
+            expected(context, SyntaxCategory_##category, (token)); \
             YYABORT;                                               \
         } while (0)
 }
 
 %union {
-    Item* item;
-    Expr* expr;
-    FunctionTypeExpr* func_type;
+    ItemId item;
+    ExprId expr;
     AstString string;
     BigInt integer;
 }
@@ -81,7 +88,7 @@
 %type <expr> type
 
 %type <expr> return_type
-%type <func_type> function_item_signature
+%type <expr> function_item_signature
 
 /* Set to 0 so that EndOfFile == YYEOF */
 %token EndOfFile 0
@@ -168,7 +175,11 @@
  * Items
  */
 
-file: item { SUCCESS($1); }
+file: items { SUCCESS(); }
+
+items:
+      item { Module_add_item(context->ast, &context->module, $1); }
+    | items item { Module_add_item(context->ast, &context->module, $2); }
 
 item:
       function_item { $$ = $1; }
@@ -187,7 +198,7 @@ stmt:
 
 return_stmt:
     Return expr
-    { $$ = (Expr*)ReturnExpr_new(context->ast, $2); }
+    { $$ = ReturnExpr_new(context->ast, $2); }
 
 /*
  * Expressions
@@ -198,8 +209,8 @@ expr:
     | error { EXPECTED(Expr, @$); }
 
 primary_expr:
-      Identifier { $$ = (Expr*)NameExpr_new(context->ast, $1); }
-    | IntLiteral { $$ = (Expr*)IntLiteralExpr_new(context->ast, $1); }
+      Identifier { $$ = NameExpr_new(context->ast, $1); }
+    | IntLiteral { $$ = IntLiteralExpr_new(context->ast, $1); }
     | LeftParen expr RightParen { $$ = $2; }
 
 /*
@@ -217,7 +228,7 @@ return_type:
 
 function_item:
     Def Identifier function_item_signature block
-    { $$ = (Item*)FunctionItem_new(context->ast, $2, $3, $4); }
+    { $$ = FunctionItem_new(context->ast, $2, $3, $4); }
 
 function_item_signature:
     function_item_params return_type
@@ -234,29 +245,27 @@ function_item_params:
 #include <stdlib.h>
 #include <string.h>
 
-static void success(ParseContext* context, Item* item) {
+static void success(ParseContext* context) {
     context->result->kind = ParseResultKind_Success;
-    context->result->u.item = item;
+    context->result->u.module = context->module;
 }
 
 static void expected(
-    ParseContext* context, SyntaxCategory category, uint32_t token_index
+    ParseContext* context, SyntaxCategory category, ParseLocation token
 ) {
     ParseError* error;
-    Token* token;
 
     context->result->kind = ParseResultKind_ParseError;
 
-    token = &context->tokens->data[token_index];
     error = &context->result->u.parse_error;
 
     error->expected_category = category;
-    error->actual_token_pos = token->pos;
-    error->actual_token_kind = token->kind;
+    error->actual_token_offset = token.offset;
+    error->actual_token_kind = token.kind;
 }
 
 static void yyerror(
-    uint32_t* loc, ParseContext* context, char const* message
+    ParseLocation* loc, ParseContext* context, char const* message
 ) {
     (void)loc; /* unused */
     context->result->kind = ParseResultKind_YaccError;
@@ -264,30 +273,34 @@ static void yyerror(
     context->result->u.yacc_error.size = strlen(message);
 }
 
-static int yylex(YaccValue* value, uint32_t* loc, ParseContext* context) {
-    Token const* token;
-
-    (void)loc; /* unused */
+static int yylex(
+    YaccValue* value, ParseLocation* loc, ParseContext* context
+) {
+    Token token;
 
-    *loc = context->token_index;
+    if (!Lexer_next(context->lexer, &token)) {
+        /* End the input here. `parse` reports the lex error instead. */
+        context->lex_failed = true;
+        token.kind = TokenKind_EndOfFile;
+        token.offset = 0;
+    }
 
-    assert(context->token_index < context->tokens->size);
-    token = &context->tokens->data[context->token_index];
-    context->token_index += 1;
+    loc->offset = token.offset;
+    loc->kind = token.kind;
 
-    switch (token->kind) {
+    switch (token.kind) {
     case TokenKind_Identifier:
-        value->string = token->value.string;
+        value->string = token.value.string;
         break;
     case TokenKind_IntLiteral:
-        value->integer = token->value.integer;
+        value->integer = token.value.integer;
         break;
     default:
         break;
     }
 
     /* Translate TokenKind to Yacc token value. */
-    switch (token->kind) {
+    switch (token.kind) {
     #define X(name, str) case TokenKind_##name: return name;
     TOKEN_KIND_LIST(X)
     #undef X
@@ -297,13 +310,26 @@ static int yylex(YaccValue* value, uint32_t* loc, ParseContext* context) {
     }
 }
 
-void parse(ParseResult* result, AstContext* context, TokenList const* tokens) {
+void parse(ParseResult* result, AstContext* context, Lexer* lexer) {
     ParseContext parse_context;
-    assert(tokens->size > 0);
-    assert(tokens->data[tokens->size - 1].kind == TokenKind_EndOfFile);
-    parse_context.tokens = tokens;
-    parse_context.token_index = 0;
+    parse_context.lexer = lexer;
+    parse_context.lex_failed = false;
     parse_context.result = result;
     parse_context.ast = context;
+
+    /* Errors found in the whole file before lexing come first, as when the
+     * file was lexed before parsing. */
+    if (!Lexer_check_known_error(lexer)) {
+        result->kind = ParseResultKind_LexError;
+        result->u.lex_error = *Lexer_error(lexer);
+        return;
+    }
+
+    Module_init(context, &parse_context.module);
     yyparse(&parse_context);
+
+    if (parse_context.lex_failed) {
+        result->kind = ParseResultKind_LexError;
+        result->u.lex_error = *Lexer_error(lexer);
+    }
 }
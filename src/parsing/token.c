@@ -1,6 +1,8 @@
 #include "src/parsing/token.h"
+#include "src/support/malloc.h"
 
 #include <assert.h>
+#include <string.h>
 
 static StringRef const token_kind_names[] = {
     #define X(name, str) STATIC_STRING_REF(#name),
@@ -30,24 +32,173 @@ StringRef TokenKind_spelling(TokenKind kind) {
     return token_kind_spellings[kind];
 }
 
+/*
+ * Keyword table
+ *
+ * Keywords are hashed by length, first, and last character. The hash is
+ * collision-free for the current KEYWORD_KIND_LIST, so a lookup is one table
+ * load and at most one compare. A keyword added later that collides takes the
+ * next free slot and costs an extra compare until the hash is retuned.
+ */
+
+#define KEYWORD_TABLE_SIZE 64
+
+typedef struct KeywordSlot {
+    StringRef spelling;
+    TokenKind kind;
+    /* Copy of the first byte, to avoid loading the spelling. */
+    uint8_t first;
+} KeywordSlot;
+
+static KeywordSlot keyword_table[KEYWORD_TABLE_SIZE];
+static size_t keyword_max_size;
+static int keyword_table_ready;
+
+static uint32_t keyword_hash(uint8_t const* data, size_t size) {
+    return (data[0] * 2 + data[size - 1] * 2 + size) % KEYWORD_TABLE_SIZE;
+}
+
+void TokenKind_init_keywords(void) {
+    static KeywordSlot const keywords[] = {
+        #define X(name, str) { STATIC_STRING_REF(str), TokenKind_##name, 0 },
+        KEYWORD_KIND_LIST(X)
+        #undef X
+    };
+    size_t count;
+    size_t i;
+
+    if (keyword_table_ready) {
+        return;
+    }
+
+    count = sizeof(keywords) / sizeof(keywords[0]);
+    assert(count < KEYWORD_TABLE_SIZE);
+
+    for (i = 0; i < count; i += 1) {
+        StringRef spelling;
+        uint32_t slot;
+        spelling = keywords[i].spelling;
+        slot = keyword_hash(spelling.data, spelling.size);
+        while (keyword_table[slot].spelling.size != 0) {
+            slot = (slot + 1) % KEYWORD_TABLE_SIZE;
+        }
+        keyword_table[slot] = keywords[i];
+        keyword_table[slot].first = spelling.data[0];
+        if (spelling.size > keyword_max_size) {
+            keyword_max_size = spelling.size;
+        }
+    }
+
+    keyword_table_ready = true;
+}
+
+TokenKind TokenKind_from_identifier(uint8_t const* data, size_t size) {
+    uint32_t slot;
+
+    assert(keyword_table_ready);
+    assert(size > 0);
+
+    if (size > keyword_max_size) {
+        return TokenKind_Identifier;
+    }
+
+    slot = keyword_hash(data, size);
+
+    for (;;) {
+        KeywordSlot const* entry;
+        entry = &keyword_table[slot];
+
+        if (entry->spelling.size == 0) {
+            return TokenKind_Identifier;
+        }
+
+        /* Checking the first byte rejects most non-keywords before the
+         * full compare. Keywords are short, so compare inline. */
+        if (entry->spelling.size == size && entry->first == data[0]) {
+            size_t i;
+            for (i = 1; i < size; i += 1) {
+                if (entry->spelling.data[i] != data[i]) {
+                    break;
+                }
+            }
+            if (i == size) {
+                return entry->kind;
+            }
+        }
+
+        slot = (slot + 1) % KEYWORD_TABLE_SIZE;
+    }
+}
+
 StringRef LexErrorKind_name(LexErrorKind kind) {
     assert(kind < LexErrorKind_COUNT);
     return lex_error_kind_names[kind];
 }
 
-void Token_dump(Token const* token, Writer* writer) {
+int TokenKind_has_value(TokenKind kind) {
+    return kind == TokenKind_Identifier || kind == TokenKind_IntLiteral;
+}
+
+void TokenList_destroy(TokenList* tokens) {
+    xfree(tokens->kinds);
+    xfree(tokens->offsets);
+    xfree(tokens->values);
+}
+
+int TokenList_equal(TokenList const* a, TokenList const* b) {
+    size_t i;
+    size_t value = 0;
+
+    if (a->size != b->size || a->values_size != b->values_size) {
+        return false;
+    }
+    if (
+        memcmp(a->kinds, b->kinds, a->size) != 0
+        || memcmp(a->offsets, b->offsets, a->size * sizeof(uint32_t)) != 0
+    ) {
+        return false;
+    }
+
+    for (i = 0; i < a->size; i += 1) {
+        TokenValue const* x;
+        TokenValue const* y;
+
+        if (!TokenKind_has_value(a->kinds[i])) {
+            continue;
+        }
+
+        x = &a->values[value];
+        y = &b->values[value];
+        value += 1;
+
+        if (a->kinds[i] == TokenKind_Identifier) {
+            /* Interned, so equal names have equal data. */
+            if (x->string.value.data != y->string.value.data) {
+                return false;
+            }
+        } else if (BigInt_compare(x->integer, y->integer) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Token_dump(
+    TokenKind kind, TokenValue const* value, SourcePos pos, Writer* writer
+) {
     Writer_format(writer, "Token(kind = .");
-    Writer_write_str(writer, TokenKind_name(token->kind));
+    Writer_write_str(writer, TokenKind_name(kind));
 
-    switch (token->kind) {
+    switch (kind) {
     case TokenKind_IntLiteral:
         Writer_format(writer, ", value = ");
-        BigInt_write(writer, token->value.integer, 10);
+        BigInt_write(writer, value->integer, 10);
         break;
 
     case TokenKind_Identifier:
         Writer_format(writer, ", value = \"");
-        Writer_write_str(writer, token->value.string.value);
+        Writer_write_str(writer, value->string.value);
         Writer_format(writer, "\"");
         break;
 
@@ -55,9 +206,7 @@ void Token_dump(Token const* token, Writer* writer) {
         break;
     }
 
-    Writer_format(
-        writer, ", position = <%u:%u>", token->pos.line, token->pos.column
-    );
+    Writer_format(writer, ", position = <%u:%u>", pos.line, pos.column);
 
     Writer_format(writer, ")\n");
 }
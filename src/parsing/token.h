@@ -94,6 +94,18 @@ typedef enum TokenKind {
 StringRef TokenKind_name(TokenKind kind);
 StringRef TokenKind_spelling(TokenKind kind);
 
+/**
+ * Build the keyword table. Called by the lexer before first use. The table
+ * is built at run time behind an unsynchronized flag, so the first call must
+ * happen before any other thread looks up keywords. Every lexer entry point
+ * calls it on the calling thread before lexing or starting threads.
+ */
+void TokenKind_init_keywords(void);
+
+/** Keyword kind of an identifier, or TokenKind_Identifier if it isn't one.
+ * `TokenKind_init_keywords` must have been called. */
+TokenKind TokenKind_from_identifier(uint8_t const* data, size_t size);
+
 #define LEX_ERROR_KIND_LIST(X) \
     X(BadEncoding)             \
     X(UnexpectedCharacter)     \
@@ -114,27 +126,55 @@ typedef enum LexErrorKind {
 StringRef LexErrorKind_name(LexErrorKind kind);
 
 typedef struct LexError {
-    SourcePos pos;
+    /* Byte offset in the source file. */
+    uint32_t offset;
     LexErrorKind kind;
     union {
         int32_t character;
     } value;
 } LexError;
 
+/** Identifier name or integer literal value of a token. */
+typedef union TokenValue {
+    BigInt integer;
+    AstString string;
+} TokenValue;
+
+/** True for the token kinds that carry a TokenValue. */
+int TokenKind_has_value(TokenKind kind);
+
 typedef struct Token {
-    SourcePos pos;
     TokenKind kind;
-    union {
-        BigInt integer;
-        AstString string;
-    } value;
+    /* Byte offset in the source file. */
+    uint32_t offset;
+    /* Only set if TokenKind_has_value. */
+    TokenValue value;
 } Token;
 
+/**
+ * Tokens stored as parallel arrays, so most tokens take five bytes. Only
+ * tokens with a value have an entry in `values`, in token order, so the value
+ * of a token is found by counting the valued tokens before it.
+ */
 typedef struct TokenList {
-    Token* data;
+    /* TokenKind of each token. */
+    uint8_t* kinds;
+    /* Byte offset of each token in the source file. */
+    uint32_t* offsets;
     size_t size;
+
+    TokenValue* values;
+    size_t values_size;
 } TokenList;
 
-void Token_dump(Token const* token, Writer* writer);
+void TokenList_destroy(TokenList* tokens);
+
+/** Whether both lists have the same tokens and values. Identifiers are
+ * compared by interned data, so the lists must share an AstContext. */
+int TokenList_equal(TokenList const* a, TokenList const* b);
+
+void Token_dump(
+    TokenKind kind, TokenValue const* value, SourcePos pos, Writer* writer
+);
 
 #endif
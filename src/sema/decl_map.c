@@ -2,83 +2,126 @@
 #include "src/support/malloc.h"
 
 #include <assert.h>
-
-static HashMapConfig const map_config = HASH_MAP_CONFIG(
-    AstString,
-    Decl,
-    AstString_hash_generic,
-    AstString_equal_generic
-);
+#include <string.h>
 
 void DeclMap_init(DeclMap* decls) {
-    decls->active = NULL;
-    decls->cache = NULL;
+    decls->innermost = NULL;
+    decls->innermost_size = 0;
+    decls->bindings = NULL;
+    decls->bindings_size = 0;
+    decls->bindings_capacity = 0;
+    decls->scopes = NULL;
+    decls->scopes_size = 0;
+    decls->scopes_capacity = 0;
     DeclMap_push_scope(decls);
 }
 
-static void destroy_node_stack(DeclMapNode* node) {
-    while (node != NULL) {
-        DeclMapNode* next;
-        next = node->next;
-        HashMap_destroy(&node->map);
-        xfree(node);
-        node = next;
-    }
-}
-
 void DeclMap_destroy(DeclMap* decls) {
-    destroy_node_stack(decls->active);
-    destroy_node_stack(decls->cache);
+    xfree(decls->innermost);
+    xfree(decls->bindings);
+    xfree(decls->scopes);
 }
 
 void DeclMap_push_scope(DeclMap* decls) {
-    DeclMapNode* new_top;
-
-    if (decls->cache != NULL) {
-        /* Pop cached if possible */
-        new_top = decls->cache;
-        decls->cache = new_top->next;
-    } else {
-        /* Otherwise allocate new */
-        new_top = xmalloc(sizeof(DeclMapNode));
-        HashMap_init(&new_top->map, &map_config);
-    }
-
-    new_top->next = decls->active;
-    decls->active = new_top;
+    decls->scopes = ensure_array_capacity(
+        sizeof(size_t),
+        decls->scopes,
+        &decls->scopes_size,
+        &decls->scopes_capacity,
+        1
+    );
+    decls->scopes[decls->scopes_size] = decls->bindings_size;
+    decls->scopes_size += 1;
 }
 
 void DeclMap_pop_scope(DeclMap* decls) {
-    DeclMapNode* old_top;
-    assert(decls->active != NULL);
+    size_t start;
+    assert(decls->scopes_size > 0);
+
+    decls->scopes_size -= 1;
+    start = decls->scopes[decls->scopes_size];
+
+    /* Undo the scope's bindings, innermost first. */
+    while (decls->bindings_size > start) {
+        DeclBinding const* binding;
+
+        decls->bindings_size -= 1;
+        binding = &decls->bindings[decls->bindings_size];
+
+        assert(decls->innermost[binding->name] == decls->bindings_size + 1);
+        decls->innermost[binding->name] = binding->shadowed;
+    }
+}
 
-    /* Pop active */
-    old_top = decls->active;
-    decls->active = old_top->next;
+Decl const* DeclMap_get(DeclMap* decls, Symbol name) {
+    uint32_t index;
 
-    /* Push cached */
-    old_top->next = decls->cache;
-    decls->cache = old_top;
+    assert(name != 0);
 
-    HashMap_reset(&old_top->map);
+    if (name >= decls->innermost_size) {
+        return NULL;
+    }
+
+    index = decls->innermost[name];
+    if (index == 0) {
+        return NULL;
+    }
+
+    return &decls->bindings[index - 1].decl;
 }
 
-Decl const* DeclMap_get(DeclMap* decls, AstString name) {
-    DeclMapNode* node;
-    node = decls->active;
-
-    while (node != NULL) {
-        Decl const* value;
-        value = HashMap_get_value_by_key(&node->map, &map_config, &name);
-        if (value != NULL) {
-            return value;
-        }
-        node = node->next;
+/* Grow `innermost` to cover `name`, leaving new symbols unbound. */
+static void ensure_symbol(DeclMap* decls, Symbol name) {
+    size_t new_size;
+
+    if (name < decls->innermost_size) {
+        return;
+    }
+
+    new_size = decls->innermost_size == 0 ? 16 : decls->innermost_size;
+    while (new_size <= name) {
+        new_size *= 2;
     }
 
-    return NULL;
+    decls->innermost = xreallocarray(
+        decls->innermost, new_size, sizeof(uint32_t)
+    );
+    memset(
+        decls->innermost + decls->innermost_size,
+        0,
+        (new_size - decls->innermost_size) * sizeof(uint32_t)
+    );
+    decls->innermost_size = new_size;
 }
 
-void DeclMap_set(DeclMap* decls, AstString name, Decl const* decl) {
-    HashMap_set(&decls->active->map, &map_config, &name, decl);
+void DeclMap_set(DeclMap* decls, Symbol name, Decl const* decl) {
+    uint32_t* index;
+    DeclBinding* binding;
+
+    assert(name != 0);
+    assert(decls->scopes_size > 0);
+
+    ensure_symbol(decls, name);
+    index = &decls->innermost[name];
+
+    /* Replace a declaration from the same scope. */
+    if (*index > decls->scopes[decls->scopes_size - 1]) {
+        decls->bindings[*index - 1].decl = *decl;
+        return;
+    }
+
+    decls->bindings = ensure_array_capacity(
+        sizeof(DeclBinding),
+        decls->bindings,
+        &decls->bindings_size,
+        &decls->bindings_capacity,
+        1
+    );
+    binding = &decls->bindings[decls->bindings_size];
+    binding->decl = *decl;
+    binding->name = name;
+    binding->shadowed = *index;
+    decls->bindings_size += 1;
+
+    *index = decls->bindings_size;
 }
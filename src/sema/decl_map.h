@@ -2,14 +2,13 @@
 #define _ZENO_SPEC_SRC_SEMA_DECL_MAP_H
 
 #include "src/ast/nodes.h"
-#include "src/support/hash_map.h"
 
 typedef enum DeclKind {
     DeclKind_Const
 } DeclKind;
 
 typedef struct ConstDecl {
-    Expr* value;
+    ExprId value;
     Type* type;
 } ConstDecl;
 
@@ -20,15 +19,36 @@ typedef struct Decl {
     } as;
 } Decl;
 
-typedef struct DeclMapNode {
-    struct DeclMapNode* next;
-    HashMap map;
-} DeclMapNode;
+/** Declaration of a name, and the declaration it shadows. */
+typedef struct DeclBinding {
+    Decl decl;
+    Symbol name;
+    /* Index + 1 of the shadowed binding in `bindings`, or 0. */
+    uint32_t shadowed;
+} DeclBinding;
 
-/** Stack of scopes mapping name to declaration. */
+/**
+ * Stack of scopes mapping name to declaration.
+ *
+ * `innermost` holds the innermost binding of every name, indexed by symbol,
+ * so a lookup is a single load at any depth. `bindings` doubles as an undo
+ * log: popping a scope removes the bindings made since it was pushed and
+ * restores the ones they shadowed.
+ */
 typedef struct DeclMap {
-    DeclMapNode* active;
-    DeclMapNode* cache;
+    /* Index + 1 in `bindings` for each symbol, or 0 if unbound. Symbols past
+     * the end are unbound. */
+    uint32_t* innermost;
+    size_t innermost_size;
+
+    DeclBinding* bindings;
+    size_t bindings_size;
+    size_t bindings_capacity;
+
+    /* Size of `bindings` when each scope was pushed. */
+    size_t* scopes;
+    size_t scopes_size;
+    size_t scopes_capacity;
 } DeclMap;
 
 void DeclMap_init(DeclMap* decls);
@@ -41,9 +61,9 @@ void DeclMap_push_scope(DeclMap* decls);
 void DeclMap_pop_scope(DeclMap* decls);
 
 /** Get declaration by name, or NULL if not present. */
-Decl const* DeclMap_get(DeclMap* decls, AstString name);
+Decl const* DeclMap_get(DeclMap* decls, Symbol name);
 
 /** Set declaration by name. */
-void DeclMap_set(DeclMap* decls, AstString name, Decl const* decl);
+void DeclMap_set(DeclMap* decls, Symbol name, Decl const* decl);
 
 #endif
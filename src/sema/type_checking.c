@@ -1,13 +1,37 @@
 #include "src/sema/type_checking.h"
 #include "src/sema/decl_map.h"
+#include "src/support/malloc.h"
+#include "src/support/thread.h"
 
 #include <assert.h>
 #include <setjmp.h>
 
+/* Fewest items worth a thread of their own. */
+#ifndef TYPE_CHECK_MIN_ITEMS_PER_THREAD
+    #define TYPE_CHECK_MIN_ITEMS_PER_THREAD 256
+#endif
+
+#define PRELUDE_LIST(X) \
+    X(Int32)
+
+#define X(name) + 1
+enum { PRELUDE_SIZE = 0 PRELUDE_LIST(X) };
+#undef X
+
+/*
+ * Names declared in every item. Built once before checking, which interns
+ * the names, so that threads checking bodies only read it.
+ */
+typedef struct Prelude {
+    Symbol names[PRELUDE_SIZE];
+    Decl decls[PRELUDE_SIZE];
+} Prelude;
+
 typedef struct TypeContext {
     DeclMap decls;
     Type* return_type; /* nullable */
     AstContext* ast;
+    AstNodes* nodes;
     TypeCheckResult* result;
     jmp_buf exit_jmp_buf;
     Type* type_type;
@@ -18,9 +42,10 @@ static void exit_type_checking(TypeContext* context) {
     longjmp(context->exit_jmp_buf, 1);
 }
 
-static void report_undeclared_name(TypeContext* context, NameExpr* expr) {
+static void report_undeclared_name(TypeContext* context, ExprId expr) {
     context->result->kind = TypeCheckResultKind_UndeclaredName;
-    context->result->as.undeclared_name.name = expr->name.value;
+    context->result->as.undeclared_name.name =
+        NameExpr_name(context->nodes, expr).value;
     context->result->as.undeclared_name.pos.line = 0;
     context->result->as.undeclared_name.pos.column = 0;
     exit_type_checking(context);
@@ -37,54 +62,64 @@ static void report_expected_type(
     exit_type_checking(context);
 }
 
-static void add_simple_type(
-    TypeContext* context, SimpleTypeKind kind, char const* name
-) {
-    Decl decl;
-
-    decl.kind = DeclKind_Const;
-
-    decl.as.const_decl.value =
-        (Expr*)AstContext_simple_type_expr(context->ast, kind);
-    decl.as.const_decl.type =
-        (Type*)AstContext_simple_type(context->ast, SimpleTypeKind_Type);
-
-    DeclMap_set(
-        &context->decls,
-        AstContext_add_string(context->ast, StringRef_from_zstr(name)),
-        &decl
-    );
+static void Prelude_init(Prelude* prelude, AstContext* ast) {
+    static char const* const names[PRELUDE_SIZE] = {
+        #define X(name) #name,
+        PRELUDE_LIST(X)
+        #undef X
+    };
+    static SimpleTypeKind const kinds[PRELUDE_SIZE] = {
+        #define X(name) SimpleTypeKind_##name,
+        PRELUDE_LIST(X)
+        #undef X
+    };
+    size_t i;
+
+    for (i = 0; i < PRELUDE_SIZE; i += 1) {
+        Decl* decl;
+
+        prelude->names[i] =
+            AstContext_add_string(ast, StringRef_from_zstr(names[i])).symbol;
+
+        decl = &prelude->decls[i];
+        decl->kind = DeclKind_Const;
+        decl->as.const_decl.value = AstContext_simple_type_expr(ast, kinds[i]);
+        decl->as.const_decl.type =
+            (Type*)AstContext_simple_type(ast, SimpleTypeKind_Type);
+    }
 }
 
-static void add_prelude(TypeContext* context) {
-    add_simple_type(context, SimpleTypeKind_Int32, "Int32");
+static void add_prelude(TypeContext* context, Prelude const* prelude) {
+    size_t i;
+    for (i = 0; i < PRELUDE_SIZE; i += 1) {
+        DeclMap_set(&context->decls, prelude->names[i], &prelude->decls[i]);
+    }
 }
 
 /*
  * Type lifting - as_type
  */
 
-static Type* as_type(TypeContext* context, Expr* expr);
+static Type* as_type(TypeContext* context, ExprId expr);
 
-static Type* as_type_impl(TypeContext* context, Expr* expr) {
-    switch (expr->kind) {
+static Type* as_type_impl(TypeContext* context, ExprId expr) {
+    switch (Expr_kind(context->nodes, expr)) {
     case ExprKind_SimpleType:
         return (Type*)AstContext_simple_type(
-            context->ast, ((SimpleTypeExpr*)expr)->kind
+            context->ast, SimpleTypeExpr_kind(context->nodes, expr)
         );
 
     case ExprKind_FunctionType: {
-        FunctionTypeExpr* func_type_expr;
         Type* return_type;
 
-        func_type_expr = (FunctionTypeExpr*)expr;
-
-        return_type = as_type(context, func_type_expr->return_type);
+        return_type = as_type(
+            context, FunctionTypeExpr_return_type(context->nodes, expr)
+        );
         if (return_type == NULL) {
             return NULL;
         }
 
-        return (Type*)FunctionType_new(context->ast, return_type);
+        return (Type*)AstContext_function_type(context->ast, return_type);
     }
 
     default:
@@ -92,39 +127,49 @@ static Type* as_type_impl(TypeContext* context, Expr* expr) {
     }
 }
 
-static Type* as_type(TypeContext* context, Expr* expr) {
-    if (expr->as_type == NULL) {
-        expr->as_type = as_type_impl(context, expr);
+static Type* as_type(TypeContext* context, ExprId expr) {
+    Type* type;
+
+    type = Expr_info(context->nodes, expr)->as_type;
+    if (type == NULL) {
+        type = as_type_impl(context, expr);
+        AstNodes_expr_info(context->nodes, expr)->as_type = type;
     }
-    return expr->as_type;
+    return type;
 }
 
 /*
  * Constant evaluation
  */
 
-static Expr* const_eval(TypeContext* context, Expr* expr);
+static ExprId const_eval(TypeContext* context, ExprId expr);
 
-static Expr* const_eval_impl(TypeContext* context, Expr* expr) {
-    switch (expr->kind) {
+static ExprId const_eval_impl(TypeContext* context, ExprId expr) {
+    switch (Expr_kind(context->nodes, expr)) {
     default:
-        return NULL;
+        return 0;
 
     /* ConstEval-Value */
     case ExprKind_IntLiteral:
+        return AstContext_int_value(
+            context->ast, IntLiteralExpr_value(context->nodes, expr)
+        );
+
     case ExprKind_SimpleType:
-        return expr;
+        return AstContext_simple_type_expr(
+            context->ast, SimpleTypeExpr_kind(context->nodes, expr)
+        );
 
     /* ConstEval-Name */
     case ExprKind_Name: {
-        NameExpr* name_expr;
         Decl const* decl;
 
-        name_expr = (NameExpr*)expr;
-        decl = DeclMap_get(&context->decls, name_expr->name);
+        decl = DeclMap_get(
+            &context->decls, NameExpr_name(context->nodes, expr).symbol
+        );
 
         if (decl == NULL) {
-            report_undeclared_name(context, name_expr);
+            report_undeclared_name(context, expr);
         }
 
         switch (decl->kind) {
@@ -132,44 +177,45 @@ static Expr* const_eval_impl(TypeContext* context, Expr* expr) {
             return decl->as.const_decl.value;
 
         default:
-            return NULL;
+            return 0;
         }
     }
 
     /* ConstEval-FunctionType */
     case ExprKind_FunctionType: {
-        FunctionTypeExpr* func_type_expr;
-        Expr* return_type;
-
-        func_type_expr = (FunctionTypeExpr*)expr;
+        ExprId return_type;
 
-        return_type = const_eval(context, func_type_expr->return_type);
-        if (return_type == NULL) {
-            return NULL;
+        return_type = const_eval(
+            context, FunctionTypeExpr_return_type(context->nodes, expr)
+        );
+        if (return_type == 0) {
+            return 0;
         }
 
-        return (Expr*)FunctionTypeExpr_new(context->ast, return_type);
+        return AstContext_function_type_value(context->ast, return_type);
     }
     }
 }
 
-static Expr* const_eval(TypeContext* context, Expr* expr) {
-    if (expr->const_eval == NULL) {
-        expr->const_eval = const_eval_impl(context, expr);
+static ExprId const_eval(TypeContext* context, ExprId expr) {
+    ExprId value;
+
+    value = Expr_info(context->nodes, expr)->const_eval;
+    if (value == 0) {
+        value = const_eval_impl(context, expr);
+        AstNodes_expr_info(context->nodes, expr)->const_eval = value;
     }
-    return expr->const_eval;
+    return value;
 }
 
 /*
  * Typing
  */
 
-static void type_function_item(TypeContext* context, FunctionItem* item);
-
-static Type* type_expr(TypeContext* context, Expr* expr);
+static Type* type_expr(TypeContext* context, ExprId expr);
 
-static Type* type_expr_impl(TypeContext* context, Expr* expr) {
-    switch (expr->kind) {
+static Type* type_expr_impl(TypeContext* context, ExprId expr) {
+    switch (Expr_kind(context->nodes, expr)) {
     /* TypeExpr-IntLiteral */
     case ExprKind_IntLiteral:
         return (Type*)AstContext_simple_type(
@@ -178,31 +224,28 @@ static Type* type_expr_impl(TypeContext* context, Expr* expr) {
 
     /* TypeExpr-Return */
     case ExprKind_Return: {
-        ReturnExpr* return_expr;
+        Type* value_type;
 
         assert(context->return_type != NULL); /* TODO: report error */
-        return_expr = (ReturnExpr*)expr;
 
-        type_expr(context, return_expr->value);
+        value_type = type_expr(context, ReturnExpr_value(context->nodes, expr));
 
-        if (!Type_equal(context->return_type, return_expr->value->type)) {
-            report_expected_type(
-                context, return_expr->value->type, context->return_type
-            );
+        if (!Type_equal(context->return_type, value_type)) {
+            report_expected_type(context, value_type, context->return_type);
         }
 
         return context->never_type;
     }
 
     case ExprKind_Name: {
-        NameExpr* name_expr;
         Decl const* decl;
 
-        name_expr = (NameExpr*)expr;
-        decl = DeclMap_get(&context->decls, name_expr->name);
+        decl = DeclMap_get(
+            &context->decls, NameExpr_name(context->nodes, expr).symbol
+        );
 
         if (decl == NULL) {
-            report_undeclared_name(context, name_expr);
+            report_undeclared_name(context, expr);
         }
 
         switch (decl->kind) {
@@ -223,55 +266,221 @@ static Type* type_expr_impl(TypeContext* context, Expr* expr) {
     assert(0 && "unreachable");
 }
 
-static Type* type_expr(TypeContext* context, Expr* expr) {
-    if (expr->type == NULL) {
-        expr->type = type_expr_impl(context, expr);
+static Type* type_expr(TypeContext* context, ExprId expr) {
+    Type* type;
+
+    type = Expr_info(context->nodes, expr)->type;
+    if (type == NULL) {
+        type = type_expr_impl(context, expr);
+        AstNodes_expr_info(context->nodes, expr)->type = type;
     }
-    return expr->type;
+    return type;
 }
 
-static void type_function_item(TypeContext* context, FunctionItem* item) {
-    Expr* func_type_expr;
+/*
+ * Items
+ *
+ * Checking a signature may intern types and constant values, so signatures
+ * are checked one at a time. Checking a body only annotates its own
+ * expressions and reads the context, so bodies may be checked in parallel.
+ */
+
+static FunctionType* type_function_signature(
+    TypeContext* context, ItemId item
+) {
+    FunctionItem const* function;
+    ExprId func_type_expr;
+    Type* func_type_expr_type;
     FunctionType* func_type;
-    Type* old_return_type;
 
-    func_type_expr = const_eval(context, (Expr*)item->type);
-    type_expr(context, func_type_expr);
+    function = FunctionItem_get(context->nodes, item);
+
+    func_type_expr = const_eval(context, function->type);
+    func_type_expr_type = type_expr(context, func_type_expr);
 
-    if (!Type_equal(func_type_expr->type, context->type_type)) {
-        report_expected_type(context, func_type_expr->type, context->type_type);
+    if (!Type_equal(func_type_expr_type, context->type_type)) {
+        report_expected_type(
+            context, func_type_expr_type, context->type_type
+        );
     }
 
     func_type = (FunctionType*)as_type(context, func_type_expr);
     assert(func_type->base.kind == TypeKind_Function);
 
+    return func_type;
+}
+
+static void type_function_body(
+    TypeContext* context, ItemId item, FunctionType const* func_type
+) {
+    Type* old_return_type;
+
     DeclMap_push_scope(&context->decls);
     old_return_type = context->return_type;
     context->return_type = func_type->return_type;
 
-    type_expr(context, item->body);
+    type_expr(context, FunctionItem_get(context->nodes, item)->body);
 
     context->return_type = old_return_type;
     DeclMap_pop_scope(&context->decls);
 }
 
-void type_check(TypeCheckResult* result, AstContext* ast, FunctionItem* item) {
+static void TypeContext_init(
+    TypeContext* context, AstContext* ast, Prelude const* prelude
+) {
+    DeclMap_init(&context->decls);
+    context->return_type = NULL;
+    context->ast = ast;
+    context->nodes = AstContext_nodes(ast);
+    context->result = NULL;
+    context->type_type =
+        (Type*)AstContext_simple_type(ast, SimpleTypeKind_Type);
+    context->never_type =
+        (Type*)AstContext_simple_type(ast, SimpleTypeKind_Never);
+
+    add_prelude(context, prelude);
+}
+
+static void TypeContext_destroy(TypeContext* context) {
+    DeclMap_destroy(&context->decls);
+}
+
+/*
+ * Modules
+ *
+ * An error in one item makes later items irrelevant to the result, so
+ * signatures are checked up to the first failure, and each thread stops at
+ * the first body that fails.
+ */
+
+/* Bodies of a contiguous range of a module's items, checked on one thread. */
+typedef struct BodyChunk {
+    AstContext* ast;
+    Prelude const* prelude;
+    Module const* module;
+    FunctionType* const* types;
+    size_t start;
+    size_t end;
+    TypeCheckResult result;
+    Thread thread;
+} BodyChunk;
+
+/* Leaves NULL in `types` from the first failing signature on. */
+static void check_signatures(
+    TypeContext* context, Module const* module, FunctionType** types
+) {
+    size_t i;
+
+    for (i = 0; i < module->items_size; i += 1) {
+        types[i] = NULL;
+    }
+
+    for (i = 0; i < module->items_size; i += 1) {
+        types[i] = type_function_signature(
+            context, Module_item(context->nodes, module, i)
+        );
+    }
+}
+
+static void check_bodies(TypeContext* context, BodyChunk const* chunk) {
+    size_t i;
+
+    for (i = chunk->start; i < chunk->end; i += 1) {
+        type_function_body(
+            context,
+            Module_item(context->nodes, chunk->module, i),
+            chunk->types[i]
+        );
+    }
+}
+
+static void check_body_chunk(void* arg) {
+    BodyChunk* chunk;
     TypeContext context;
 
-    DeclMap_init(&context.decls);
-    context.return_type = NULL;
-    context.ast = ast;
-    context.result = result;
-    context.type_type = (Type*)AstContext_simple_type(ast, SimpleTypeKind_Type);
-    context.never_type = (Type*)AstContext_simple_type(ast, SimpleTypeKind_Never);
+    chunk = arg;
+    chunk->result.kind = TypeCheckResultKind_Success;
+
+    TypeContext_init(&context, chunk->ast, chunk->prelude);
+    context.result = &chunk->result;
+
+    if (setjmp(context.exit_jmp_buf) == 0) {
+        check_bodies(&context, chunk);
+    }
+
+    TypeContext_destroy(&context);
+}
+
+void type_check_module(
+    TypeCheckResult* result,
+    AstContext* ast,
+    Module const* module,
+    unsigned max_threads
+) {
+    Prelude prelude;
+    TypeContext context;
+    FunctionType** types;
+    BodyChunk* chunks;
+    size_t items_size;
+    size_t count;
+    size_t i;
 
     result->kind = TypeCheckResultKind_Success;
 
-    add_prelude(&context);
+    Prelude_init(&prelude, ast);
+    types = xallocarray(module->items_size, sizeof(FunctionType*));
 
+    TypeContext_init(&context, ast, &prelude);
+    context.result = result;
     if (setjmp(context.exit_jmp_buf) == 0) {
-        type_function_item(&context, item);
+        check_signatures(&context, module, types);
+    }
+    TypeContext_destroy(&context);
+
+    /* Items whose signatures passed. */
+    items_size = 0;
+    while (items_size < module->items_size && types[items_size] != NULL) {
+        items_size += 1;
+    }
+
+    /* No more expressions are made, so bodies can be annotated in place. */
+    AstNodes_reserve_expr_infos(AstContext_nodes(ast));
+
+    count = items_size / TYPE_CHECK_MIN_ITEMS_PER_THREAD;
+    if (count > max_threads) {
+        count = max_threads;
+    }
+    if (count < 1) {
+        count = 1;
+    }
+
+    chunks = xallocarray(count, sizeof(BodyChunk));
+    for (i = 0; i < count; i += 1) {
+        chunks[i].ast = ast;
+        chunks[i].prelude = &prelude;
+        chunks[i].module = module;
+        chunks[i].types = types;
+        chunks[i].start = items_size * i / count;
+        chunks[i].end = items_size * (i + 1) / count;
+    }
+
+    /* Check the first chunk on this thread. */
+    for (i = 1; i < count; i += 1) {
+        Thread_start(&chunks[i].thread, check_body_chunk, &chunks[i]);
+    }
+    check_body_chunk(&chunks[0]);
+    for (i = 1; i < count; i += 1) {
+        Thread_join(&chunks[i].thread);
+    }
+
+    /* A failing body comes before the failing signature, if any. */
+    for (i = 0; i < count; i += 1) {
+        if (chunks[i].result.kind != TypeCheckResultKind_Success) {
+            *result = chunks[i].result;
+            break;
+        }
     }
 
-    DeclMap_destroy(&context.decls);
+    xfree(chunks);
+    xfree(types);
 }
@@ -30,6 +30,17 @@ typedef struct TypeCheckResult {
     } as;
 } TypeCheckResult;
 
-void type_check(TypeCheckResult* result, AstContext* ast, FunctionItem* item);
+/**
+ * Type check the items of `module`. Signatures are checked first, in order;
+ * then function bodies, which are independent of each other, are checked on
+ * up to `max_threads` threads. The result is the error of the first item in
+ * source order that has one.
+ */
+void type_check_module(
+    TypeCheckResult* result,
+    AstContext* ast,
+    Module const* module,
+    unsigned max_threads
+);
 
 #endif
@@ -0,0 +1,144 @@
+#undef NDEBUG
+
+#include "src/sema/type_checking.h"
+#include "src/parsing/parse.h"
+#include "src/support/array_writer.h"
+
+#include <assert.h>
+
+/* Enough items for 4 threads at the default
+ * TYPE_CHECK_MIN_ITEMS_PER_THREAD. */
+#define ITEM_COUNT 4096
+
+#define THREAD_COUNT 4
+
+/* Items with a special body or return type, by index. */
+typedef struct BadItem {
+    size_t index;
+    char const* return_name;
+    char const* body_name;
+} BadItem;
+
+/* One function per line, returning its own index unless listed in `bad`. */
+static void generate_module(
+    ArrayWriter* writer, BadItem const* bad, size_t bad_size
+) {
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < ITEM_COUNT; i += 1) {
+        char const* return_name = "Int32";
+        char const* body_name = NULL;
+
+        for (j = 0; j < bad_size; j += 1) {
+            if (bad[j].index == i) {
+                if (bad[j].return_name != NULL) {
+                    return_name = bad[j].return_name;
+                }
+                body_name = bad[j].body_name;
+            }
+        }
+
+        Writer_write_zstr(&writer->base, "def f");
+        Writer_write_uint(&writer->base, i, 10);
+        Writer_write_zstr(&writer->base, "() -> ");
+        Writer_write_zstr(&writer->base, return_name);
+        Writer_write_zstr(&writer->base, " { return ");
+        if (body_name != NULL) {
+            Writer_write_zstr(&writer->base, body_name);
+        } else {
+            Writer_write_uint(&writer->base, i, 10);
+        }
+        Writer_write_zstr(&writer->base, "; }\n");
+    }
+}
+
+/* Type check the generated module, expecting success if `error_name` is
+ * NULL, else that name to be reported undeclared. Names are unique to their
+ * item, as errors carry no position yet. */
+static void check_module(
+    BadItem const* bad, size_t bad_size, char const* error_name
+) {
+    StringRef name = STATIC_STRING_REF("type_checking_test.zn");
+    AstContext* ast;
+    ArrayWriter writer;
+    SourceFile const* source;
+    Lexer* lexer;
+    ParseResult parse_result;
+    TypeCheckResult result;
+
+    ast = AstContext_new();
+    ArrayWriter_init(&writer);
+
+    generate_module(&writer, bad, bad_size);
+    source = AstContext_source_from_bytes(ast, name, writer.data, writer.size);
+
+    lexer = Lexer_new(ast, source);
+    parse(&parse_result, ast, lexer);
+    Lexer_delete(lexer);
+
+    assert(parse_result.kind == ParseResultKind_Success);
+    assert(parse_result.u.module.items_size == ITEM_COUNT);
+
+    type_check_module(&result, ast, &parse_result.u.module, THREAD_COUNT);
+
+    if (error_name == NULL) {
+        assert(result.kind == TypeCheckResultKind_Success);
+    } else {
+        assert(result.kind == TypeCheckResultKind_UndeclaredName);
+        assert(StringRef_equal_zstr(
+            result.as.undeclared_name.name, error_name
+        ));
+    }
+
+    ArrayWriter_destroy(&writer);
+    AstContext_delete(ast);
+}
+
+int main(void) {
+    check_module(NULL, 0, NULL);
+
+    /* Errors in bodies checked on later threads. */
+    {
+        BadItem const bad[] = { { 3500, NULL, "late" } };
+        check_module(bad, 1, "late");
+    }
+    {
+        BadItem const bad[] = {
+            { 3500, NULL, "late" },
+            { 1500, NULL, "early" }
+        };
+        check_module(bad, 2, "early");
+    }
+    {
+        BadItem const bad[] = {
+            { 4000, NULL, "last" },
+            { 1030, NULL, "second" },
+            { 10, NULL, "first" }
+        };
+        check_module(bad, 3, "first");
+    }
+
+    /* A signature error stops checking before the bodies after it, but a
+     * body error before it comes first. */
+    {
+        BadItem const bad[] = { { 4000, "Late", NULL } };
+        check_module(bad, 1, "Late");
+    }
+    {
+        BadItem const bad[] = {
+            { 4000, "Late", NULL },
+            { 2100, NULL, "early" }
+        };
+        check_module(bad, 2, "early");
+    }
+    {
+        BadItem const bad[] = {
+            { 2100, "Early", NULL },
+            { 4000, NULL, "late" }
+        };
+        check_module(bad, 2, "Early");
+    }
+
+    return 0;
+}
@@ -1,40 +1,212 @@
 #include "src/support/arena.h"
 #include "src/support/malloc.h"
+#include "src/support/stdint.h"
 
-/* TODO: use actual arena allocation but keep this per-allocation chunk
- * implementation as an option. Useful for checking under AddressSanitizer. */
+#include <assert.h>
+
+/* Smallest and largest bump chunk size, including the chunk header. */
+#define ARENA_MIN_CHUNK_SIZE 4096
+#define ARENA_MAX_CHUNK_SIZE (1024 * 1024)
+
+/* Union of the types with the strictest alignment requirements. */
+typedef union ArenaMaxAlign {
+    long l;
+    double d;
+    long double ld;
+    void* p;
+    void (*f)(void);
+    intmax_t im;
+} ArenaMaxAlign;
+
+#define ARENA_ALIGNMENT offsetof(struct { char c; ArenaMaxAlign u; }, u)
+
+#define ALIGN_UP(n) (((n) + (ARENA_ALIGNMENT - 1)) & ~(ARENA_ALIGNMENT - 1))
 
 typedef struct ArenaChunk {
     struct ArenaChunk* next;
-    void* data;
+    size_t size;
 } ArenaChunk;
 
-void Arena_init(Arena* arena) {
-    arena->chunks = NULL;
+/* Chunk data starts after the header, padded to keep it aligned. */
+#define CHUNK_HEADER_SIZE ALIGN_UP(sizeof(ArenaChunk))
+
+static char* chunk_data(ArenaChunk* chunk) {
+    return (char*)chunk + CHUNK_HEADER_SIZE;
 }
 
-void Arena_destroy(Arena* arena) {
+static ArenaChunk* new_chunk(size_t data_size) {
     ArenaChunk* chunk;
-    chunk = arena->chunks;
+    if (data_size > (size_t)-1 - CHUNK_HEADER_SIZE) {
+        exit_out_of_memory();
+    }
+    chunk = xmalloc(CHUNK_HEADER_SIZE + data_size);
+    chunk->next = NULL;
+    chunk->size = data_size;
+    return chunk;
+}
 
+static void free_chunk_list(ArenaChunk* chunk) {
     while (chunk != NULL) {
         ArenaChunk* next;
         next = chunk->next;
-        xfree(chunk->data);
         xfree(chunk);
         chunk = next;
     }
 }
 
+void Arena_init(Arena* arena) {
+    arena->chunks = NULL;
+    arena->large_chunks = NULL;
+    arena->free_chunks = NULL;
+    arena->cursor = NULL;
+    arena->limit = NULL;
+    arena->next_chunk_size = ARENA_MIN_CHUNK_SIZE;
+}
+
+void Arena_destroy(Arena* arena) {
+    free_chunk_list(arena->chunks);
+    free_chunk_list(arena->large_chunks);
+    free_chunk_list(arena->free_chunks);
+    arena->chunks = NULL;
+    arena->large_chunks = NULL;
+    arena->free_chunks = NULL;
+    arena->cursor = NULL;
+    arena->limit = NULL;
+}
+
+ArenaMark Arena_mark(Arena const* arena) {
+    ArenaMark mark;
+    mark.chunk = arena->chunks;
+    mark.large_chunk = arena->large_chunks;
+    mark.cursor = arena->cursor;
+    return mark;
+}
+
+void Arena_reset(Arena* arena) {
+    ArenaMark mark;
+    mark.chunk = NULL;
+    mark.large_chunk = NULL;
+    mark.cursor = NULL;
+    Arena_rollback(arena, mark);
+}
+
+#ifdef ARENA_PER_ALLOCATION
+
 void* Arena_allocate(Arena* arena, size_t size) {
     ArenaChunk* chunk;
-    void* data;
+    chunk = new_chunk(size);
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    return chunk_data(chunk);
+}
+
+void Arena_rollback(Arena* arena, ArenaMark mark) {
+    /* Free allocations so AddressSanitizer sees any later use. */
+    while (arena->chunks != mark.chunk) {
+        ArenaChunk* chunk;
+        assert(arena->chunks != NULL);
+        chunk = arena->chunks;
+        arena->chunks = chunk->next;
+        xfree(chunk);
+    }
+}
+
+#else
+
+static void* allocate_slow(Arena* arena, size_t size) {
+    ArenaChunk* chunk;
+    ArenaChunk** link;
+    size_t chunk_size;
+
+    /* Large allocations get a dedicated block so they don't waste the rest
+     * of the current chunk. */
+    if (size > (arena->next_chunk_size - CHUNK_HEADER_SIZE) / 4) {
+        chunk = new_chunk(size);
+        chunk->next = arena->large_chunks;
+        arena->large_chunks = chunk;
+        return chunk_data(chunk);
+    }
+
+    /* Reuse the oldest released chunk that fits. Chunks double in size, so
+     * one too small for `size` is often followed by one big enough. */
+    link = &arena->free_chunks;
+    while (*link != NULL && (*link)->size < size) {
+        link = &(*link)->next;
+    }
+
+    if (*link != NULL) {
+        chunk = *link;
+        *link = chunk->next;
+    } else {
+        chunk_size = arena->next_chunk_size;
+        if (arena->next_chunk_size < ARENA_MAX_CHUNK_SIZE) {
+            arena->next_chunk_size *= 2;
+        }
+        chunk = new_chunk(chunk_size - CHUNK_HEADER_SIZE);
+    }
 
-    chunk = xmalloc(sizeof(ArenaChunk));
-    data = xmalloc(size);
-    chunk->data = data;
     chunk->next = arena->chunks;
     arena->chunks = chunk;
 
+    arena->cursor = chunk_data(chunk) + size;
+    arena->limit = chunk_data(chunk) + chunk->size;
+    assert(arena->cursor <= arena->limit);
+
+    return chunk_data(chunk);
+}
+
+void* Arena_allocate(Arena* arena, size_t size) {
+    char* data;
+
+    /* Every allocation gets a unique address, even empty ones. */
+    if (size == 0) {
+        size = 1;
+    }
+
+    /* No block this large could exist, and aligning it would wrap. */
+    if (size > (size_t)-1 - ARENA_ALIGNMENT) {
+        exit_out_of_memory();
+    }
+    size = ALIGN_UP(size);
+
+    if (size > (size_t)(arena->limit - arena->cursor)) {
+        return allocate_slow(arena, size);
+    }
+
+    data = arena->cursor;
+    arena->cursor += size;
     return data;
 }
+
+void Arena_rollback(Arena* arena, ArenaMark mark) {
+    /* Large blocks go back to the system. */
+    while (arena->large_chunks != mark.large_chunk) {
+        ArenaChunk* chunk;
+        assert(arena->large_chunks != NULL);
+        chunk = arena->large_chunks;
+        arena->large_chunks = chunk->next;
+        xfree(chunk);
+    }
+
+    /* Chunks newer than the mark are kept for reuse. Pushing them in
+     * newest-first order leaves the free list oldest first, so they get
+     * reused in their original order. */
+    while (arena->chunks != mark.chunk) {
+        ArenaChunk* chunk;
+        assert(arena->chunks != NULL);
+        chunk = arena->chunks;
+        arena->chunks = chunk->next;
+        chunk->next = arena->free_chunks;
+        arena->free_chunks = chunk;
+    }
+
+    if (mark.chunk == NULL) {
+        arena->cursor = NULL;
+        arena->limit = NULL;
+    } else {
+        arena->cursor = mark.cursor;
+        arena->limit = chunk_data(mark.chunk) + mark.chunk->size;
+    }
+}
+
+#endif
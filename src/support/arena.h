@@ -3,14 +3,53 @@
 
 #include <stddef.h>
 
-/** Arena allocator. */
+/*
+ * Arena allocator.
+ *
+ * Allocations are bump-allocated out of chunks that double in size as the
+ * arena grows. Allocations too big to fit comfortably in a chunk get their own
+ * dedicated block. Everything is freed at once by `Arena_destroy`, or released
+ * for reuse by `Arena_rollback` and `Arena_reset`, which keep the chunks.
+ *
+ * Define ARENA_PER_ALLOCATION to give every allocation its own malloc block
+ * instead. This is slower but lets AddressSanitizer catch out-of-bounds
+ * accesses between neighboring objects.
+ */
 typedef struct Arena {
+    /* Chunks that are bump-allocated from, newest (current) first. */
     struct ArenaChunk* chunks;
+    /* Dedicated blocks for large allocations, newest first. */
+    struct ArenaChunk* large_chunks;
+    /* Released chunks waiting to be reused, oldest first. */
+    struct ArenaChunk* free_chunks;
+    /* Free space in the current chunk. */
+    char* cursor;
+    char* limit;
+    /* Size of the next chunk to allocate. */
+    size_t next_chunk_size;
 } Arena;
 
+/** Saved allocation state of an arena. */
+typedef struct ArenaMark {
+    struct ArenaChunk* chunk;
+    struct ArenaChunk* large_chunk;
+    char* cursor;
+} ArenaMark;
+
 void Arena_init(Arena* arena);
 void Arena_destroy(Arena* arena);
+
+/** Allocate `size` bytes aligned for any type. Never returns NULL. */
 void* Arena_allocate(Arena* arena, size_t size);
 
+/** Save the current allocation state. */
+ArenaMark Arena_mark(Arena const* arena);
+
+/** Release everything allocated since `mark` was taken.
+ * Marks taken after `mark` are invalidated. */
+void Arena_rollback(Arena* arena, ArenaMark mark);
+
+/** Release all allocations but keep the chunks for reuse. */
+void Arena_reset(Arena* arena);
 
 #endif
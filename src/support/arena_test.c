@@ -0,0 +1,145 @@
+#undef NDEBUG
+
+#include "src/support/arena.h"
+
+#include <assert.h>
+#include <string.h>
+
+/* Built twice, once with ARENA_PER_ALLOCATION. Both builds check that marks,
+ * rollbacks, and resets release the right allocations; the chunked build
+ * also checks that released memory is handed out again. */
+
+#define BLOCK_SIZE 64
+
+/* Enough blocks to go through several chunks. */
+#define BLOCK_COUNT 2048
+
+static char* blocks[BLOCK_COUNT];
+
+static void allocate_blocks(Arena* arena, size_t count) {
+    size_t i;
+
+    for (i = 0; i < count; i += 1) {
+        blocks[i] = Arena_allocate(arena, BLOCK_SIZE);
+        memset(blocks[i], (int)i, BLOCK_SIZE);
+    }
+}
+
+static void mark_tests(void) {
+    Arena arena;
+    ArenaMark empty;
+    ArenaMark mark;
+    char* first;
+    char* kept;
+    char* after;
+    size_t i;
+
+    Arena_init(&arena);
+
+    empty = Arena_mark(&arena);
+    first = Arena_allocate(&arena, 10);
+    kept = Arena_allocate(&arena, 20);
+    memset(kept, 'k', 20);
+
+    mark = Arena_mark(&arena);
+    allocate_blocks(&arena, BLOCK_COUNT);
+    /* A large allocation, with a block of its own in the chunked build. */
+    Arena_allocate(&arena, 100000);
+
+    Arena_rollback(&arena, mark);
+    assert(arena.chunks == mark.chunk);
+    for (i = 0; i < 20; i += 1) {
+        assert(kept[i] == 'k');
+    }
+
+    after = Arena_allocate(&arena, BLOCK_SIZE);
+#ifndef ARENA_PER_ALLOCATION
+    /* Allocation picks up where it was at the mark. */
+    assert(after == blocks[0]);
+    assert(arena.large_chunks == mark.large_chunk);
+#endif
+    (void)after;
+
+    /* Going through the same blocks again reuses the released chunks. */
+    Arena_rollback(&arena, mark);
+    {
+        char* old_blocks[BLOCK_COUNT];
+        memcpy(old_blocks, blocks, sizeof(blocks));
+        allocate_blocks(&arena, BLOCK_COUNT);
+#ifndef ARENA_PER_ALLOCATION
+        for (i = 0; i < BLOCK_COUNT; i += 1) {
+            assert(blocks[i] == old_blocks[i]);
+        }
+#endif
+    }
+
+    Arena_rollback(&arena, empty);
+    assert(arena.chunks == NULL);
+    assert(arena.large_chunks == NULL);
+
+    /* The first chunk is reused from its start. */
+    after = Arena_allocate(&arena, 10);
+#ifndef ARENA_PER_ALLOCATION
+    assert(after == first);
+#endif
+    (void)first;
+
+    Arena_destroy(&arena);
+}
+
+static void reset_tests(void) {
+    Arena arena;
+    char* chunk_starts[BLOCK_COUNT];
+    size_t chunk_count = 0;
+    char* data;
+    size_t i;
+
+    Arena_init(&arena);
+
+    /* Blocks are contiguous within a chunk, so a gap starts a new one. */
+    allocate_blocks(&arena, BLOCK_COUNT);
+    for (i = 0; i < BLOCK_COUNT; i += 1) {
+        if (i == 0 || blocks[i] != blocks[i - 1] + BLOCK_SIZE) {
+            chunk_starts[chunk_count] = blocks[i];
+            chunk_count += 1;
+        }
+    }
+
+    Arena_reset(&arena);
+    assert(arena.chunks == NULL);
+    assert(arena.large_chunks == NULL);
+
+#ifndef ARENA_PER_ALLOCATION
+    assert(chunk_count >= 3);
+
+    /* Too big for the first chunk, but small enough for a later one. Reuse
+     * takes that chunk rather than getting a new one. */
+    data = Arena_allocate(&arena, 5000);
+    for (i = 0; i < chunk_count; i += 1) {
+        if (data == chunk_starts[i]) {
+            break;
+        }
+    }
+    assert(i > 0 && i < chunk_count);
+
+    /* A small allocation after another reset reuses a chunk too. */
+    Arena_reset(&arena);
+    data = Arena_allocate(&arena, BLOCK_SIZE);
+    for (i = 0; i < chunk_count; i += 1) {
+        if (data == chunk_starts[i]) {
+            break;
+        }
+    }
+    assert(i < chunk_count);
+#else
+    (void)data;
+#endif
+
+    Arena_destroy(&arena);
+}
+
+int main(void) {
+    mark_tests();
+    reset_tests();
+    return 0;
+}
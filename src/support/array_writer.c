@@ -18,6 +18,7 @@ static SystemIoError ArrayWriter_write(
 
 void ArrayWriter_init(ArrayWriter* writer) {
     writer->base.write = ArrayWriter_write;
+    writer->base.flush = NULL;
     writer->data = NULL;
     writer->size = 0;
     writer->capacity = 0;
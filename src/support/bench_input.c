@@ -0,0 +1,79 @@
+#include "src/support/bench_input.h"
+#include "src/support/io.h"
+#include "src/support/malloc.h"
+
+static int is_identifier_start(uint8_t ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_';
+}
+
+static int is_identifier_continue(uint8_t ch) {
+    return is_identifier_start(ch) || (ch >= '0' && ch <= '9');
+}
+
+uint8_t* read_bench_file(char const* path, size_t* out_size) {
+    SystemFile file;
+    uint8_t* data = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+
+    if (SystemFile_open_read(&file, path) != SystemIoError_Success) {
+        Writer_format(Writer_stderr, "could not open %s\n", path);
+        return NULL;
+    }
+
+    for (;;) {
+        size_t wanted;
+        size_t size_read;
+        data = ensure_array_capacity(1, data, &size, &capacity, 65536);
+        wanted = capacity - size;
+        if (SystemFile_read(file, data + size, wanted, &size_read) != 0) {
+            Writer_format(Writer_stderr, "could not read %s\n", path);
+            break;
+        }
+        size += size_read;
+        if (size_read < wanted) {
+            break;
+        }
+    }
+
+    SystemFile_close(file);
+    *out_size = size;
+    return data;
+}
+
+StringRef* collect_identifiers(
+    StringRef* identifiers,
+    size_t* size,
+    size_t* capacity,
+    uint8_t const* data,
+    size_t data_size
+) {
+    size_t i = 0;
+
+    while (i < data_size) {
+        StringRef* identifier;
+
+        if (!is_identifier_start(data[i])) {
+            /* Skip the rest of numbers like 0x10 as well. */
+            while (i < data_size && is_identifier_continue(data[i])) {
+                i += 1;
+            }
+            i += 1;
+            continue;
+        }
+
+        identifiers = ensure_array_capacity(
+            sizeof(StringRef), identifiers, size, capacity, 4096
+        );
+        identifier = &identifiers[*size];
+        *size += 1;
+
+        identifier->data = data + i;
+        while (i < data_size && is_identifier_continue(data[i])) {
+            i += 1;
+        }
+        identifier->size = (data + i) - identifier->data;
+    }
+
+    return identifiers;
+}
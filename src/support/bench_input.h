@@ -0,0 +1,30 @@
+#ifndef _ZENO_SPEC_SRC_SUPPORT_BENCH_INPUT_H
+#define _ZENO_SPEC_SRC_SUPPORT_BENCH_INPUT_H
+
+/*
+ * Input for benchmarks: identifiers harvested from source files.
+ */
+
+#include "src/support/stdint.h"
+#include "src/support/string_ref.h"
+
+#include <stddef.h>
+
+/** Read a whole file into memory freed with `xfree`. Reports errors to
+ * stderr and returns NULL if the file cannot be opened. */
+uint8_t* read_bench_file(char const* path, size_t* out_size);
+
+/**
+ * Append the identifier-like words of `data` to the array `identifiers`,
+ * growing it as needed, and return the array. The identifiers point into
+ * `data`.
+ */
+StringRef* collect_identifiers(
+    StringRef* identifiers,
+    size_t* size,
+    size_t* capacity,
+    uint8_t const* data,
+    size_t data_size
+);
+
+#endif
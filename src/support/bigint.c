@@ -1,63 +1,1074 @@
 #include "src/support/bigint.h"
+#include "src/support/bits.h"
+#include "src/support/fnv1a.h"
 #include "src/support/io.h"
 #include "src/support/malloc.h"
 
 #include <assert.h>
-#include <stdlib.h>
+#include <string.h>
 
-#define BIGINT_INLINE_MAX ((INT64_C(1) << 62) - 1)
-#define BIGINT_INLINE_MIN (-BIGINT_INLINE_MAX - 1)
+/* Products of magnitudes at least this many limbs long use Karatsuba's
+ * method instead of long multiplication. */
+#define KARATSUBA_THRESHOLD 32
 
-BigInt BigInt_from_int(intmax_t value) {
+/* Base conversions split magnitudes at least this many limbs long in two,
+ * so the work goes into a few large multiplications or divisions. */
+#define CONVERSION_THRESHOLD 32
+
+/*
+ * Representation
+ *
+ * Inline values are shifted left with the low bit set. Other values point to
+ * a BigIntData in an arena, which is aligned so the low bit is clear. Values
+ * in the inline range are always inline, so every value has a single
+ * representation and heap magnitudes are larger than any inline one.
+ *
+ * Heap values are a sign and a magnitude in 32-bit limbs, least significant
+ * first, without leading zero limbs. The limbs follow the header.
+ */
+
+typedef struct BigIntData {
+    uint32_t size;
+    uint32_t is_negative;
+} BigIntData;
+
+#define DATA_LIMBS(data) ((uint32_t*)((data) + 1))
+
+static int is_inline(BigInt a) {
+    return (a.opaque & 1) != 0;
+}
+
+static int64_t inline_value(BigInt a) {
+    return (int64_t)a.opaque >> 1;
+}
+
+static BigInt make_inline(int64_t value) {
     BigInt bigint;
-    if (value <= BIGINT_INLINE_MAX && value >= BIGINT_INLINE_MIN) {
-        bigint.opaque = (value << 1) | 1;
+    assert(value >= BIGINT_INLINE_MIN && value <= BIGINT_INLINE_MAX);
+    bigint.opaque = ((uint64_t)value << 1) | 1;
+    return bigint;
+}
+
+static int fits_inline(int64_t value) {
+    return value >= BIGINT_INLINE_MIN && value <= BIGINT_INLINE_MAX;
+}
+
+/* Sign and magnitude of a value. Inline values are expanded into `buffer`. */
+typedef struct BigIntView {
+    uint32_t const* limbs;
+    size_t size;
+    int is_negative;
+    uint32_t buffer[2];
+} BigIntView;
+
+static void view_init(BigIntView* view, BigInt a) {
+    if (is_inline(a)) {
+        int64_t value;
+        uint64_t magnitude;
+
+        value = inline_value(a);
+        magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+
+        view->buffer[0] = (uint32_t)magnitude;
+        view->buffer[1] = (uint32_t)(magnitude >> 32);
+        view->limbs = view->buffer;
+        view->size = view->buffer[1] != 0 ? 2 : view->buffer[0] != 0;
+        view->is_negative = value < 0;
     } else {
-        bigint.opaque = 0;
+        BigIntData const* data;
+        data = (BigIntData const*)(intptr_t)a.opaque;
+        view->limbs = DATA_LIMBS(data);
+        view->size = data->size;
+        view->is_negative = data->is_negative;
     }
-    return bigint;
 }
 
-BigInt BigInt_from_uint(uintmax_t value) {
+static size_t limbs_trim(uint32_t const* limbs, size_t size) {
+    while (size > 0 && limbs[size - 1] == 0) {
+        size -= 1;
+    }
+    return size;
+}
+
+/* Value with the given sign and magnitude, copied to `arena` unless it fits
+ * inline. */
+static BigInt make_value(
+    Arena* arena, uint32_t const* limbs, size_t size, int is_negative
+) {
+    BigIntData* data;
     BigInt bigint;
-    if (value <= (intmax_t)BIGINT_INLINE_MAX) {
-        bigint.opaque = (value << 1) | 1;
-    } else {
-        bigint.opaque = 0;
+
+    size = limbs_trim(limbs, size);
+
+    if (size <= 2) {
+        uint64_t magnitude;
+
+        magnitude = size == 0 ? 0 : limbs[0];
+        if (size == 2) {
+            magnitude |= (uint64_t)limbs[1] << 32;
+        }
+
+        if (magnitude <= BIGINT_INLINE_MAX) {
+            return make_inline(
+                is_negative ? -(int64_t)magnitude : (int64_t)magnitude
+            );
+        }
+        if (is_negative && magnitude == (uint64_t)BIGINT_INLINE_MAX + 1) {
+            return make_inline(BIGINT_INLINE_MIN);
+        }
     }
+
+    data = Arena_allocate(arena, sizeof(BigIntData) + size * sizeof(uint32_t));
+    data->size = size;
+    data->is_negative = is_negative;
+    memcpy(DATA_LIMBS(data), limbs, size * sizeof(uint32_t));
+
+    bigint.opaque = (intptr_t)data;
     return bigint;
 }
 
-void BigInt_destroy(BigInt* bigint) {
-    if (bigint->opaque & 1) {
-        return;
+static BigInt from_magnitude(
+    Arena* arena, uintmax_t magnitude, int is_negative
+) {
+    uint32_t limbs[sizeof(uintmax_t) / sizeof(uint32_t)];
+    size_t size = 0;
+
+    while (magnitude != 0) {
+        limbs[size] = (uint32_t)magnitude;
+        size += 1;
+        /* Two steps, since shifting a 32-bit uintmax_t by 32 is undefined. */
+        magnitude = (magnitude >> 16) >> 16;
+    }
+
+    return make_value(arena, limbs, size, is_negative);
+}
+
+BigInt BigInt_from_int(Arena* arena, intmax_t value) {
+    if (value >= BIGINT_INLINE_MIN && value <= BIGINT_INLINE_MAX) {
+        return make_inline(value);
+    }
+    if (value < 0) {
+        return from_magnitude(arena, -(uintmax_t)value, true);
+    }
+    return from_magnitude(arena, value, false);
+}
+
+BigInt BigInt_from_uint(Arena* arena, uintmax_t value) {
+    if (value <= BIGINT_INLINE_MAX) {
+        return make_inline(value);
+    }
+    return from_magnitude(arena, value, false);
+}
+
+BigInt BigInt_copy(Arena* arena, BigInt bigint) {
+    BigIntView view;
+
+    if (is_inline(bigint)) {
+        return bigint;
     }
-    /* xfree((void*)bigint->opaque); */
+
+    view_init(&view, bigint);
+    return make_value(arena, view.limbs, view.size, view.is_negative);
 }
 
 uint32_t BigInt_as_uint32(BigInt bigint) {
-    return (uint32_t)bigint.opaque >> 1;
+    BigIntView view;
+
+    if (is_inline(bigint)) {
+        return (uint32_t)inline_value(bigint);
+    }
+
+    view_init(&view, bigint);
+    return view.is_negative ? 0u - view.limbs[0] : view.limbs[0];
 }
 
-BigInt BigInt_parse(ByteStringRef string, int base) {
-    uintmax_t uvalue;
-    char const* cursor;
-    char const* limit;
+/*
+ * Limb arithmetic
+ *
+ * Functions on magnitudes as limb arrays. Results may have leading zero
+ * limbs.
+ */
 
-    uvalue = 0;
-    cursor = string.data;
-    limit = cursor + string.size;
+static int limbs_compare(
+    uint32_t const* a, size_t a_size, uint32_t const* b, size_t b_size
+) {
+    size_t i;
 
-    for (;;) {
-        char ch;
-        int digit;
+    a_size = limbs_trim(a, a_size);
+    b_size = limbs_trim(b, b_size);
 
-        if (cursor == limit) {
-            break;
+    if (a_size != b_size) {
+        return a_size < b_size ? -1 : 1;
+    }
+
+    for (i = a_size; i > 0; i -= 1) {
+        if (a[i - 1] != b[i - 1]) {
+            return a[i - 1] < b[i - 1] ? -1 : 1;
         }
+    }
+
+    return 0;
+}
+
+/* r = a + b into `a_size` limbs, with a_size >= b_size. Returns the carry.
+ * `r` may be `a`. */
+static uint32_t limbs_add(
+    uint32_t* r,
+    uint32_t const* a,
+    size_t a_size,
+    uint32_t const* b,
+    size_t b_size
+) {
+    uint64_t carry = 0;
+    size_t i;
+
+    for (i = 0; i < b_size; i += 1) {
+        carry += (uint64_t)a[i] + b[i];
+        r[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    for (; i < a_size; i += 1) {
+        carry += a[i];
+        r[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+
+    return (uint32_t)carry;
+}
+
+/* r = a - b into `a_size` limbs, with a_size >= b_size. Returns the borrow.
+ * `r` may be `a`. */
+static uint32_t limbs_sub(
+    uint32_t* r,
+    uint32_t const* a,
+    size_t a_size,
+    uint32_t const* b,
+    size_t b_size
+) {
+    uint64_t borrow = 0;
+    size_t i;
+
+    for (i = 0; i < b_size; i += 1) {
+        uint64_t difference;
+        difference = (uint64_t)a[i] - b[i] - borrow;
+        r[i] = (uint32_t)difference;
+        borrow = difference >> 63;
+    }
+    for (; i < a_size; i += 1) {
+        uint64_t difference;
+        difference = (uint64_t)a[i] - borrow;
+        r[i] = (uint32_t)difference;
+        borrow = difference >> 63;
+    }
+
+    return (uint32_t)borrow;
+}
+
+/* limbs = limbs * multiplier + addend, returning the new size. There must be
+ * room for one more limb. */
+static size_t limbs_mul_add_small(
+    uint32_t* limbs, size_t size, uint32_t multiplier, uint32_t addend
+) {
+    uint64_t carry = addend;
+    size_t i;
+
+    for (i = 0; i < size; i += 1) {
+        carry += (uint64_t)limbs[i] * multiplier;
+        limbs[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+
+    if (carry != 0) {
+        limbs[size] = (uint32_t)carry;
+        size += 1;
+    }
+
+    return size;
+}
+
+/* q = a / divisor into `a_size` limbs, returning the remainder. `q` may be
+ * `a`. */
+static uint32_t limbs_divmod_small(
+    uint32_t* q, uint32_t const* a, size_t a_size, uint32_t divisor
+) {
+    uint64_t remainder = 0;
+    size_t i;
+
+    for (i = a_size; i > 0; i -= 1) {
+        uint64_t current;
+        current = (remainder << 32) | a[i - 1];
+        q[i - 1] = (uint32_t)(current / divisor);
+        remainder = current % divisor;
+    }
+
+    return (uint32_t)remainder;
+}
+
+static void limbs_mul(
+    uint32_t* r,
+    uint32_t const* a,
+    size_t a_size,
+    uint32_t const* b,
+    size_t b_size
+);
+
+/* Long multiplication into a_size + b_size limbs. */
+static void limbs_mul_long(
+    uint32_t* r,
+    uint32_t const* a,
+    size_t a_size,
+    uint32_t const* b,
+    size_t b_size
+) {
+    size_t i;
+    size_t j;
+
+    memset(r, 0, (a_size + b_size) * sizeof(uint32_t));
+
+    for (i = 0; i < b_size; i += 1) {
+        uint64_t carry = 0;
+
+        if (b[i] == 0) {
+            continue;
+        }
+
+        for (j = 0; j < a_size; j += 1) {
+            carry += (uint64_t)a[j] * b[i] + r[i + j];
+            r[i + j] = (uint32_t)carry;
+            carry >>= 32;
+        }
+        r[i + a_size] = (uint32_t)carry;
+    }
+}
+
+/*
+ * Karatsuba multiplication, for a_size >= b_size > a_size / 2. With both
+ * split at `m` limbs, a * b = z2 B^2m + z1 B^m + z0, where z0 = a0 b0 and
+ * z2 = a1 b1, and z1 = (a0 + a1)(b0 + b1) - z0 - z2 takes one product
+ * instead of two.
+ */
+static void limbs_mul_karatsuba(
+    uint32_t* r,
+    uint32_t const* a,
+    size_t a_size,
+    uint32_t const* b,
+    size_t b_size
+) {
+    size_t m;
+    size_t a_sum_size;
+    size_t b_sum_size;
+    size_t z1_size;
+    uint32_t* a_sum;
+    uint32_t* b_sum;
+    uint32_t* z1;
+
+    m = a_size / 2;
+
+    /* z0 and z2 go straight to their places in the result. */
+    limbs_mul(r, a, m, b, m);
+    limbs_mul(r + 2 * m, a + m, a_size - m, b + m, b_size - m);
+
+    /* The high half of `a` is at least as long as the low half. */
+    a_sum_size = a_size - m + 1;
+    a_sum = xallocarray(a_sum_size, sizeof(uint32_t));
+    a_sum[a_sum_size - 1] = limbs_add(a_sum, a + m, a_size - m, a, m);
+
+    if (b_size - m >= m) {
+        b_sum_size = b_size - m + 1;
+        b_sum = xallocarray(b_sum_size, sizeof(uint32_t));
+        b_sum[b_sum_size - 1] = limbs_add(b_sum, b + m, b_size - m, b, m);
+    } else {
+        b_sum_size = m + 1;
+        b_sum = xallocarray(b_sum_size, sizeof(uint32_t));
+        b_sum[b_sum_size - 1] = limbs_add(b_sum, b, m, b + m, b_size - m);
+    }
+
+    z1_size = a_sum_size + b_sum_size;
+    z1 = xallocarray(z1_size, sizeof(uint32_t));
+    limbs_mul(z1, a_sum, a_sum_size, b_sum, b_sum_size);
+    limbs_sub(z1, z1, z1_size, r, 2 * m);
+    limbs_sub(z1, z1, z1_size, r + 2 * m, a_size + b_size - 2 * m);
+
+    /* z1 = a0 b1 + a1 b0 fits in the result above B^m. */
+    z1_size = limbs_trim(z1, z1_size);
+    assert(z1_size <= a_size + b_size - m);
+    limbs_add(r + m, r + m, a_size + b_size - m, z1, z1_size);
+
+    xfree(a_sum);
+    xfree(b_sum);
+    xfree(z1);
+}
+
+/* r = a * b into a_size + b_size limbs. `r` must not overlap the inputs. */
+static void limbs_mul(
+    uint32_t* r,
+    uint32_t const* a,
+    size_t a_size,
+    uint32_t const* b,
+    size_t b_size
+) {
+    uint32_t* product;
+    size_t i;
+
+    if (a_size < b_size) {
+        uint32_t const* limbs;
+        size_t size;
+        limbs = a;
+        a = b;
+        b = limbs;
+        size = a_size;
+        a_size = b_size;
+        b_size = size;
+    }
+
+    if (b_size < KARATSUBA_THRESHOLD) {
+        limbs_mul_long(r, a, a_size, b, b_size);
+        return;
+    }
+
+    if (b_size > a_size / 2) {
+        limbs_mul_karatsuba(r, a, a_size, b, b_size);
+        return;
+    }
+
+    /* Unbalanced sizes: multiply `b` by slices of `a` as long as `b`. */
+    memset(r, 0, (a_size + b_size) * sizeof(uint32_t));
+    product = xallocarray(2 * b_size, sizeof(uint32_t));
+
+    for (i = 0; i < a_size; i += b_size) {
+        size_t slice_size;
+        slice_size = a_size - i < b_size ? a_size - i : b_size;
+        limbs_mul(product, a + i, slice_size, b, b_size);
+        limbs_add(
+            r + i, r + i, a_size + b_size - i, product, slice_size + b_size
+        );
+    }
+
+    xfree(product);
+}
+
+/*
+ * Long division (Knuth's algorithm D) of `u` by `v`, with u_size >= v_size >=
+ * 2 and no leading zero limb in `v`. The quotient gets u_size - v_size + 1
+ * limbs and the remainder v_size limbs.
+ */
+static void limbs_divmod(
+    uint32_t* q,
+    uint32_t* r,
+    uint32_t const* u,
+    size_t u_size,
+    uint32_t const* v,
+    size_t v_size
+) {
+    uint32_t* un;
+    uint32_t* vn;
+    unsigned shift;
+    size_t i;
+    size_t j;
+
+    assert(v_size >= 2);
+    assert(u_size >= v_size);
+    assert(v[v_size - 1] != 0);
+
+    /* Normalize so the top bit of the divisor is set, which keeps the
+     * estimated quotient digits within 2 of the real ones. */
+    shift = 31 - highest_bit(v[v_size - 1]);
+
+    un = xallocarray(u_size + 1, sizeof(uint32_t));
+    vn = xallocarray(v_size, sizeof(uint32_t));
+
+    if (shift == 0) {
+        memcpy(vn, v, v_size * sizeof(uint32_t));
+        memcpy(un, u, u_size * sizeof(uint32_t));
+        un[u_size] = 0;
+    } else {
+        for (i = v_size - 1; i > 0; i -= 1) {
+            vn[i] = (v[i] << shift) | (v[i - 1] >> (32 - shift));
+        }
+        vn[0] = v[0] << shift;
+
+        un[u_size] = u[u_size - 1] >> (32 - shift);
+        for (i = u_size - 1; i > 0; i -= 1) {
+            un[i] = (u[i] << shift) | (u[i - 1] >> (32 - shift));
+        }
+        un[0] = u[0] << shift;
+    }
+
+    for (j = u_size - v_size + 1; j > 0; j -= 1) {
+        size_t k;
+        uint64_t numerator;
+        uint64_t q_hat;
+        uint64_t r_hat;
+        uint64_t carry = 0;
+        uint64_t borrow = 0;
+        uint64_t difference;
+
+        k = j - 1;
+
+        numerator = ((uint64_t)un[k + v_size] << 32) | un[k + v_size - 1];
+        q_hat = numerator / vn[v_size - 1];
+        r_hat = numerator % vn[v_size - 1];
+
+        while (
+            q_hat > UINT32_MAX
+            || q_hat * vn[v_size - 2] > ((r_hat << 32) | un[k + v_size - 2])
+        ) {
+            q_hat -= 1;
+            r_hat += vn[v_size - 1];
+            if (r_hat > UINT32_MAX) {
+                break;
+            }
+        }
+
+        /* Subtract q_hat * vn from the current window. */
+        for (i = 0; i < v_size; i += 1) {
+            uint64_t product;
+            product = q_hat * vn[i] + carry;
+            carry = product >> 32;
+            difference = (uint64_t)un[i + k] - (uint32_t)product - borrow;
+            un[i + k] = (uint32_t)difference;
+            borrow = difference >> 63;
+        }
+        difference = (uint64_t)un[k + v_size] - carry - borrow;
+        un[k + v_size] = (uint32_t)difference;
+
+        /* Rarely q_hat is one too large. Add the divisor back. */
+        if ((difference >> 63) != 0) {
+            q_hat -= 1;
+            un[k + v_size] += limbs_add(un + k, un + k, v_size, vn, v_size);
+        }
+
+        q[k] = (uint32_t)q_hat;
+    }
+
+    if (shift == 0) {
+        memcpy(r, un, v_size * sizeof(uint32_t));
+    } else {
+        for (i = 0; i < v_size; i += 1) {
+            r[i] = (un[i] >> shift) | (un[i + 1] << (32 - shift));
+        }
+    }
+
+    xfree(un);
+    xfree(vn);
+}
+
+/*
+ * Arithmetic
+ *
+ * Inline operands take a fast path when the result is sure to fit 64 bits.
+ * The rest work on sign and magnitude, with temporary limbs from the heap.
+ */
+
+static BigInt add_slow(Arena* arena, BigInt a, BigInt b, int negate_b) {
+    BigIntView x;
+    BigIntView y;
+    BigIntView const* large;
+    BigIntView const* small;
+    int large_is_negative;
+    uint32_t* limbs;
+    size_t size;
+    BigInt result;
+
+    view_init(&x, a);
+    view_init(&y, b);
+    y.is_negative ^= negate_b;
+
+    if (limbs_compare(x.limbs, x.size, y.limbs, y.size) >= 0) {
+        large = &x;
+        small = &y;
+    } else {
+        large = &y;
+        small = &x;
+    }
+    large_is_negative = large->is_negative;
+
+    size = large->size + 1;
+    limbs = xallocarray(size, sizeof(uint32_t));
+
+    if (x.is_negative == y.is_negative) {
+        limbs[size - 1] = limbs_add(
+            limbs, large->limbs, large->size, small->limbs, small->size
+        );
+    } else {
+        limbs[size - 1] = 0;
+        limbs_sub(limbs, large->limbs, large->size, small->limbs, small->size);
+    }
+
+    result = make_value(arena, limbs, size, large_is_negative);
+    xfree(limbs);
+    return result;
+}
+
+BigInt BigInt_negate(Arena* arena, BigInt a) {
+    BigIntView x;
+
+    if (is_inline(a) && inline_value(a) != BIGINT_INLINE_MIN) {
+        return make_inline(-inline_value(a));
+    }
+
+    view_init(&x, a);
+    return make_value(arena, x.limbs, x.size, !x.is_negative);
+}
+
+BigInt BigInt_add(Arena* arena, BigInt a, BigInt b) {
+    if (is_inline(a) && is_inline(b)) {
+        int64_t sum;
+        sum = inline_value(a) + inline_value(b);
+        if (fits_inline(sum)) {
+            return make_inline(sum);
+        }
+    }
+    return add_slow(arena, a, b, false);
+}
+
+BigInt BigInt_sub(Arena* arena, BigInt a, BigInt b) {
+    if (is_inline(a) && is_inline(b)) {
+        int64_t difference;
+        difference = inline_value(a) - inline_value(b);
+        if (fits_inline(difference)) {
+            return make_inline(difference);
+        }
+    }
+    return add_slow(arena, a, b, true);
+}
 
-        ch = *cursor;
-        cursor += 1;
+BigInt BigInt_mul(Arena* arena, BigInt a, BigInt b) {
+    BigIntView x;
+    BigIntView y;
+    uint32_t* limbs;
+    size_t size;
+    BigInt result;
+
+    if (is_inline(a) && is_inline(b)) {
+        int64_t x_value;
+        int64_t y_value;
+        x_value = inline_value(a);
+        y_value = inline_value(b);
+        /* Both under 2^31 in magnitude, so the product is under 2^62. */
+        if (
+            x_value > -(INT64_C(1) << 31) && x_value < (INT64_C(1) << 31)
+            && y_value > -(INT64_C(1) << 31) && y_value < (INT64_C(1) << 31)
+        ) {
+            return make_inline(x_value * y_value);
+        }
+    }
+
+    view_init(&x, a);
+    view_init(&y, b);
+
+    size = x.size + y.size;
+    if (size == 0) {
+        return make_inline(0);
+    }
+
+    limbs = xallocarray(size, sizeof(uint32_t));
+    limbs_mul(limbs, x.limbs, x.size, y.limbs, y.size);
+
+    result = make_value(arena, limbs, size, x.is_negative != y.is_negative);
+    xfree(limbs);
+    return result;
+}
+
+void BigInt_divmod(
+    Arena* arena,
+    BigInt a,
+    BigInt b,
+    BigInt* out_quotient,
+    BigInt* out_remainder
+) {
+    BigIntView x;
+    BigIntView y;
+    uint32_t* quotient;
+    uint32_t* remainder;
+    size_t quotient_size;
+
+    view_init(&x, a);
+    view_init(&y, b);
+
+    assert(y.size != 0);
+
+    if (is_inline(a) && is_inline(b)) {
+        uint64_t x_magnitude;
+        uint64_t y_magnitude;
+        int64_t q;
+        int64_t r;
+
+        /* Divide magnitudes, since C89 leaves rounding of negative operands
+         * to the implementation. */
+        x_magnitude = x.buffer[0] | ((uint64_t)x.buffer[1] << 32);
+        y_magnitude = y.buffer[0] | ((uint64_t)y.buffer[1] << 32);
+        q = x_magnitude / y_magnitude;
+        r = x_magnitude % y_magnitude;
+
+        /* Only BIGINT_INLINE_MIN / -1 leaves the inline range. */
+        *out_quotient = BigInt_from_int(
+            arena, x.is_negative != y.is_negative ? -q : q
+        );
+        *out_remainder = make_inline(x.is_negative ? -r : r);
+        return;
+    }
+
+    if (limbs_compare(x.limbs, x.size, y.limbs, y.size) < 0) {
+        *out_quotient = make_inline(0);
+        *out_remainder = a;
+        return;
+    }
+
+    quotient_size = x.size - y.size + 1;
+    quotient = xallocarray(quotient_size, sizeof(uint32_t));
+
+    if (y.size == 1) {
+        uint32_t small_remainder;
+        small_remainder = limbs_divmod_small(
+            quotient, x.limbs, x.size, y.limbs[0]
+        );
+        *out_quotient = make_value(
+            arena, quotient, x.size, x.is_negative != y.is_negative
+        );
+        *out_remainder = make_value(arena, &small_remainder, 1, x.is_negative);
+        xfree(quotient);
+        return;
+    }
+
+    remainder = xallocarray(y.size, sizeof(uint32_t));
+    limbs_divmod(quotient, remainder, x.limbs, x.size, y.limbs, y.size);
+
+    *out_quotient = make_value(
+        arena, quotient, quotient_size, x.is_negative != y.is_negative
+    );
+    *out_remainder = make_value(arena, remainder, y.size, x.is_negative);
+
+    xfree(quotient);
+    xfree(remainder);
+}
+
+BigInt BigInt_shift_left(Arena* arena, BigInt a, size_t bits) {
+    BigIntView x;
+    uint32_t* limbs;
+    size_t limb_shift;
+    unsigned bit_shift;
+    size_t size;
+    size_t i;
+    BigInt result;
+
+    if (is_inline(a) && bits < 62) {
+        int64_t value;
+        value = inline_value(a);
+        if (
+            value >= (BIGINT_INLINE_MIN >> bits)
+            && value <= (BIGINT_INLINE_MAX >> bits)
+        ) {
+            return make_inline(value * ((int64_t)1 << bits));
+        }
+    }
+
+    view_init(&x, a);
+    if (x.size == 0) {
+        return a;
+    }
+
+    limb_shift = bits / 32;
+    bit_shift = bits % 32;
+    size = x.size + limb_shift + 1;
+
+    limbs = xallocarray(size, sizeof(uint32_t));
+    memset(limbs, 0, size * sizeof(uint32_t));
+
+    for (i = 0; i < x.size; i += 1) {
+        limbs[i + limb_shift] |= x.limbs[i] << bit_shift;
+        if (bit_shift != 0) {
+            limbs[i + limb_shift + 1] = x.limbs[i] >> (32 - bit_shift);
+        }
+    }
+
+    result = make_value(arena, limbs, size, x.is_negative);
+    xfree(limbs);
+    return result;
+}
+
+BigInt BigInt_shift_right(Arena* arena, BigInt a, size_t bits) {
+    BigIntView x;
+    uint32_t* limbs;
+    size_t limb_shift;
+    unsigned bit_shift;
+    size_t size;
+    size_t i;
+    int is_inexact;
+    BigInt result;
+
+    if (is_inline(a)) {
+        int64_t value;
+        value = inline_value(a);
+        if (bits > 62) {
+            bits = 62;
+        }
+        /* Shift non-negative values only: ~value is -value - 1. */
+        return make_inline(value < 0 ? ~(~value >> bits) : value >> bits);
+    }
+
+    view_init(&x, a);
+
+    limb_shift = bits / 32;
+    bit_shift = bits % 32;
+
+    if (limb_shift >= x.size) {
+        return make_inline(x.is_negative ? -1 : 0);
+    }
+
+    /* Negative values round down, away from zero, if any bit is lost. */
+    is_inexact = (x.limbs[limb_shift] & ((UINT32_C(1) << bit_shift) - 1)) != 0;
+    for (i = 0; i < limb_shift; i += 1) {
+        is_inexact |= x.limbs[i] != 0;
+    }
+
+    size = x.size - limb_shift + 1;
+    limbs = xallocarray(size, sizeof(uint32_t));
+    limbs[size - 1] = 0;
+
+    for (i = 0; i < x.size - limb_shift; i += 1) {
+        limbs[i] = x.limbs[i + limb_shift] >> bit_shift;
+        if (bit_shift != 0 && i + limb_shift + 1 < x.size) {
+            limbs[i] |= x.limbs[i + limb_shift + 1] << (32 - bit_shift);
+        }
+    }
+
+    if (x.is_negative && is_inexact) {
+        uint32_t one = 1;
+        limbs_add(limbs, limbs, size, &one, 1);
+    }
+
+    result = make_value(arena, limbs, size, x.is_negative);
+    xfree(limbs);
+    return result;
+}
+
+int BigInt_compare(BigInt a, BigInt b) {
+    BigIntView x;
+    BigIntView y;
+    int result;
+
+    /* The inline encoding preserves order. */
+    if (is_inline(a) && is_inline(b)) {
+        return (a.opaque > b.opaque) - (a.opaque < b.opaque);
+    }
+
+    view_init(&x, a);
+    view_init(&y, b);
+
+    if (x.is_negative != y.is_negative) {
+        return x.is_negative ? -1 : 1;
+    }
+
+    result = limbs_compare(x.limbs, x.size, y.limbs, y.size);
+    return x.is_negative ? -result : result;
+}
+
+uint32_t BigInt_hash(BigInt bigint) {
+    BigIntView view;
+    uint32_t hash;
+
+    /* Hash the sign and magnitude rather than the encoding, which for heap
+     * values is a pointer. */
+    view_init(&view, bigint);
+    hash = fnv1a_add_8(fnv1a_start(), view.is_negative);
+    return fnv1a_add(hash, view.limbs, view.size * sizeof(uint32_t));
+}
+
+/*
+ * Base conversion
+ *
+ * Power of two bases map digits to bits directly. Other bases group digits
+ * into chunks, the most that fit a limb. Long numbers are split in two at a
+ * chunk count that is a power of two, so the same few powers of the base
+ * serve every level: parsing joins the halves with one multiplication, and
+ * writing splits them with one division. Temporary values live in a scratch
+ * arena.
+ */
+
+/* Magnitude in a scratch arena. */
+typedef struct Nat {
+    uint32_t* limbs;
+    size_t size;
+} Nat;
+
+typedef struct Radix {
+    int base;
+    /* Digits per chunk, and base to that power. */
+    unsigned chunk_digits;
+    uint32_t chunk_value;
+    /* powers[i] is chunk_value to the power of 2^i, made as needed. */
+    Nat powers[sizeof(size_t) * 8];
+    size_t powers_size;
+    Arena scratch;
+} Radix;
+
+static char const digit_chars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+static int is_power_of_two(int base) {
+    return (base & (base - 1)) == 0;
+}
+
+static void Radix_init(Radix* radix, int base) {
+    radix->base = base;
+    radix->chunk_digits = 1;
+    radix->chunk_value = base;
+    while (radix->chunk_value <= UINT32_MAX / base) {
+        radix->chunk_digits += 1;
+        radix->chunk_value *= base;
+    }
+    radix->powers_size = 0;
+    Arena_init(&radix->scratch);
+}
+
+static void Radix_destroy(Radix* radix) {
+    Arena_destroy(&radix->scratch);
+}
+
+static Nat Radix_new_nat(Radix* radix, size_t capacity) {
+    Nat nat;
+    nat.limbs = Arena_allocate(&radix->scratch, capacity * sizeof(uint32_t));
+    nat.size = 0;
+    return nat;
+}
+
+static Nat Radix_mul(Radix* radix, Nat a, Nat b) {
+    Nat product;
+    product = Radix_new_nat(radix, a.size + b.size);
+    limbs_mul(product.limbs, a.limbs, a.size, b.limbs, b.size);
+    product.size = limbs_trim(product.limbs, a.size + b.size);
+    return product;
+}
+
+static Nat const* Radix_power(Radix* radix, size_t i) {
+    if (radix->powers_size == 0) {
+        Nat* power;
+        power = &radix->powers[0];
+        *power = Radix_new_nat(radix, 1);
+        power->limbs[0] = radix->chunk_value;
+        power->size = 1;
+        radix->powers_size = 1;
+    }
+
+    while (radix->powers_size <= i) {
+        Nat const* last;
+        last = &radix->powers[radix->powers_size - 1];
+        radix->powers[radix->powers_size] = Radix_mul(radix, *last, *last);
+        radix->powers_size += 1;
+    }
+
+    return &radix->powers[i];
+}
+
+/* Value of `size` digit values, most significant first. */
+static Nat parse_digits(Radix* radix, uint8_t const* digits, size_t size) {
+    Nat const* power;
+    Nat high;
+    Nat low;
+    Nat result;
+    size_t i;
+    size_t low_digits;
+
+    if (size <= radix->chunk_digits * CONVERSION_THRESHOLD) {
+        size_t chunk_size;
+
+        result = Radix_new_nat(radix, size / radix->chunk_digits + 1);
+
+        /* The first chunk takes the odd digits. */
+        chunk_size = size % radix->chunk_digits;
+        if (chunk_size == 0) {
+            chunk_size = radix->chunk_digits;
+        }
+
+        for (i = 0; i < size; i += chunk_size) {
+            uint32_t chunk = 0;
+            size_t j;
+            if (i > 0) {
+                chunk_size = radix->chunk_digits;
+            }
+            for (j = 0; j < chunk_size; j += 1) {
+                chunk = chunk * radix->base + digits[i + j];
+            }
+            result.size = limbs_mul_add_small(
+                result.limbs, result.size, radix->chunk_value, chunk
+            );
+        }
+
+        return result;
+    }
+
+    /* The low half gets the largest power of two number of chunks. */
+    i = 0;
+    while ((radix->chunk_digits << (i + 1)) < size) {
+        i += 1;
+    }
+    low_digits = radix->chunk_digits << i;
+
+    high = parse_digits(radix, digits, size - low_digits);
+    low = parse_digits(radix, digits + size - low_digits, low_digits);
+
+    /* The product fills all its limbs, which also hold the sum since low is
+     * less than the power. */
+    power = Radix_power(radix, i);
+    result = Radix_mul(radix, high, *power);
+    limbs_add(
+        result.limbs,
+        result.limbs,
+        high.size + power->size,
+        low.limbs,
+        low.size
+    );
+    result.size = limbs_trim(result.limbs, high.size + power->size);
+
+    return result;
+}
+
+/* Value of `size` digits in a power of two base, most significant first. */
+static Nat parse_bits(Radix* radix, uint8_t const* digits, size_t size) {
+    unsigned digit_bits;
+    size_t capacity;
+    size_t bit;
+    size_t i;
+    Nat result;
+
+    digit_bits = highest_bit(radix->base);
+    capacity = size * digit_bits / 32 + 1;
+
+    result = Radix_new_nat(radix, capacity + 1);
+    memset(result.limbs, 0, (capacity + 1) * sizeof(uint32_t));
+
+    bit = 0;
+    for (i = size; i > 0; i -= 1) {
+        uint32_t digit;
+        digit = digits[i - 1];
+        result.limbs[bit / 32] |= digit << (bit % 32);
+        if (bit % 32 + digit_bits > 32) {
+            result.limbs[bit / 32 + 1] |= digit >> (32 - bit % 32);
+        }
+        bit += digit_bits;
+    }
+
+    result.size = limbs_trim(result.limbs, capacity + 1);
+    return result;
+}
+
+BigInt BigInt_parse(Arena* arena, ByteStringRef string, int base) {
+    uint8_t* digits;
+    size_t size = 0;
+    uintmax_t uvalue = 0;
+    int is_exact = true;
+    size_t i;
+    Radix radix;
+    Nat nat;
+    BigInt result;
+
+    digits = xmalloc(string.size + 1);
+
+    for (i = 0; i < string.size; i += 1) {
+        char ch;
+        int digit;
+
+        ch = string.data[i];
 
         if (ch >= '0' && ch <= '9') {
             digit = ch - '0';
@@ -73,19 +1084,174 @@ BigInt BigInt_parse(ByteStringRef string, int base) {
             continue;
         }
 
-        uvalue *= base;
-        uvalue += digit;
-        /* assert(uvalue <= BIGINT_INLINE_MAX); */
-        /* FIXME proper overflow checking */
+        digits[size] = digit;
+        size += 1;
+
+        if (is_exact) {
+            if (uvalue > (UINTMAX_MAX - digit) / base) {
+                is_exact = false;
+            } else {
+                uvalue = uvalue * base + digit;
+            }
+        }
     }
 
-    return BigInt_from_uint(uvalue);
+    if (is_exact) {
+        xfree(digits);
+        return BigInt_from_uint(arena, uvalue);
+    }
+
+    Radix_init(&radix, base);
+    if (is_power_of_two(base)) {
+        nat = parse_bits(&radix, digits, size);
+    } else {
+        nat = parse_digits(&radix, digits, size);
+    }
+    result = make_value(arena, nat.limbs, nat.size, false);
+    Radix_destroy(&radix);
+
+    xfree(digits);
+    return result;
+}
+
+/* Write the digits of `nat` right-aligned in `size` chars, padded with
+ * zeros. The value must fit. */
+static void write_digits(Radix* radix, Nat nat, char* out, size_t size) {
+    size_t i;
+
+    if (nat.size <= CONVERSION_THRESHOLD) {
+        /* Peel off chunks from the low end. */
+        Nat rest;
+        rest = Radix_new_nat(radix, nat.size);
+        memcpy(rest.limbs, nat.limbs, nat.size * sizeof(uint32_t));
+        rest.size = nat.size;
+
+        while (size > 0) {
+            uint32_t chunk;
+            size_t j;
+
+            chunk = limbs_divmod_small(
+                rest.limbs, rest.limbs, rest.size, radix->chunk_value
+            );
+            rest.size = limbs_trim(rest.limbs, rest.size);
+
+            for (j = 0; j < radix->chunk_digits && size > 0; j += 1) {
+                size -= 1;
+                out[size] = digit_chars[chunk % radix->base];
+                chunk /= radix->base;
+            }
+        }
+
+        assert(rest.size == 0);
+        return;
+    }
+
+    /* Split at the largest power under the square root of the value. */
+    i = 0;
+    while (Radix_power(radix, i + 1)->size * 2 <= nat.size + 1) {
+        i += 1;
+    }
+
+    {
+        Nat const* power;
+        Nat quotient;
+        Nat remainder;
+        size_t low_digits;
+
+        power = Radix_power(radix, i);
+        low_digits = radix->chunk_digits << i;
+        assert(low_digits <= size);
+
+        quotient = Radix_new_nat(radix, nat.size - power->size + 1);
+        remainder = Radix_new_nat(radix, power->size);
+        if (power->size == 1) {
+            remainder.limbs[0] = limbs_divmod_small(
+                quotient.limbs, nat.limbs, nat.size, power->limbs[0]
+            );
+        } else {
+            limbs_divmod(
+                quotient.limbs,
+                remainder.limbs,
+                nat.limbs,
+                nat.size,
+                power->limbs,
+                power->size
+            );
+        }
+        quotient.size = limbs_trim(quotient.limbs, nat.size - power->size + 1);
+        remainder.size = limbs_trim(remainder.limbs, power->size);
+
+        write_digits(radix, quotient, out, size - low_digits);
+        write_digits(radix, remainder, out + size - low_digits, low_digits);
+    }
+}
+
+/* Write the digits of `nat` in a power of two base into `size` chars. */
+static void write_bits(Radix* radix, Nat nat, char* out, size_t size) {
+    unsigned digit_bits;
+    size_t bit = 0;
+
+    digit_bits = highest_bit(radix->base);
+
+    while (size > 0) {
+        uint32_t digit;
+
+        digit = 0;
+        if (bit / 32 < nat.size) {
+            digit = nat.limbs[bit / 32] >> (bit % 32);
+        }
+        if (bit % 32 + digit_bits > 32 && bit / 32 + 1 < nat.size) {
+            digit |= nat.limbs[bit / 32 + 1] << (32 - bit % 32);
+        }
+
+        size -= 1;
+        out[size] = digit_chars[digit & (radix->base - 1)];
+        bit += digit_bits;
+    }
 }
 
 SystemIoError BigInt_write(Writer* writer, BigInt bigint, int base) {
-    if (bigint.opaque & 1) {
-        return Writer_write_int(writer, bigint.opaque >> 1, base);
+    BigIntView view;
+    Radix radix;
+    Nat nat;
+    char* text;
+    size_t size;
+    size_t start;
+    SystemIoError res;
+
+    if (is_inline(bigint)) {
+        return Writer_write_int(writer, inline_value(bigint), base);
+    }
+
+    view_init(&view, bigint);
+    Radix_init(&radix, base);
+
+    nat.limbs = (uint32_t*)view.limbs;
+    nat.size = view.size;
+
+    /* At least one digit per highest_bit(base) bits, the integer part of
+     * log2(base), and one for the sign. */
+    size = view.size * 32 / highest_bit(base) + 1;
+    text = xmalloc(size + 1);
+
+    if (is_power_of_two(base)) {
+        write_bits(&radix, nat, text + 1, size);
     } else {
-        return Writer_format(writer, "<bigint>");
+        write_digits(&radix, nat, text + 1, size);
     }
+
+    start = 1;
+    while (start < size && text[start] == '0') {
+        start += 1;
+    }
+    if (view.is_negative) {
+        start -= 1;
+        text[start] = '-';
+    }
+
+    res = Writer_write(writer, text + start, size + 1 - start);
+
+    xfree(text);
+    Radix_destroy(&radix);
+    return res;
 }
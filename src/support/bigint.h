@@ -1,10 +1,19 @@
 #ifndef _ZENO_SPEC_SRC_SUPPORT_BIGINT_H
 #define _ZENO_SPEC_SRC_SUPPORT_BIGINT_H
 
+#include "src/support/arena.h"
 #include "src/support/io.h"
 #include "src/support/stdint.h"
 #include "src/support/string_ref.h"
 
+/*
+ * Arbitrary-precision integer.
+ *
+ * Values from BIGINT_INLINE_MIN to BIGINT_INLINE_MAX are stored inline and
+ * never allocate. Larger values are allocated from the arena passed to the
+ * operation producing them and live as long as it does. Operations on inline
+ * values take a fast path without touching the arena.
+ */
 typedef struct BigInt {
 #if UINTPTR_MAX < UINT64_MAX
     int64_t opaque;
@@ -13,14 +22,51 @@ typedef struct BigInt {
 #endif
 } BigInt;
 
-BigInt BigInt_from_int(intmax_t value);
-BigInt BigInt_from_uint(uintmax_t value);
+#define BIGINT_INLINE_MAX ((INT64_C(1) << 62) - 1)
+#define BIGINT_INLINE_MIN (-BIGINT_INLINE_MAX - 1)
+
+BigInt BigInt_from_int(Arena* arena, intmax_t value);
+BigInt BigInt_from_uint(Arena* arena, uintmax_t value);
+
+/** Copy of `bigint` allocated from `arena`, if it is not inline. */
+BigInt BigInt_copy(Arena* arena, BigInt bigint);
+
+/** Low 32 bits of the two's complement value. */
 uint32_t BigInt_as_uint32(BigInt bigint);
 
 /** Loosely parse sequence of `base` digits. Ignores non-base characters. */
-BigInt BigInt_parse(ByteStringRef string, int base);
+BigInt BigInt_parse(Arena* arena, ByteStringRef string, int base);
+
+BigInt BigInt_negate(Arena* arena, BigInt a);
+BigInt BigInt_add(Arena* arena, BigInt a, BigInt b);
+BigInt BigInt_sub(Arena* arena, BigInt a, BigInt b);
+BigInt BigInt_mul(Arena* arena, BigInt a, BigInt b);
+
+/**
+ * Quotient rounded toward zero, and remainder with the sign of `a`, as for C
+ * integers. `b` must not be zero.
+ */
+void BigInt_divmod(
+    Arena* arena,
+    BigInt a,
+    BigInt b,
+    BigInt* out_quotient,
+    BigInt* out_remainder
+);
+
+/** Multiply by 2 to the power of `bits`. */
+BigInt BigInt_shift_left(Arena* arena, BigInt a, size_t bits);
+
+/** Divide by 2 to the power of `bits`, rounding down like an arithmetic
+ * shift. */
+BigInt BigInt_shift_right(Arena* arena, BigInt a, size_t bits);
+
+/** Negative, zero, or positive when `a` is less than, equal to, or greater
+ * than `b`. */
+int BigInt_compare(BigInt a, BigInt b);
 
-void BigInt_destroy(BigInt* bigint);
+/** Hash of the value. Equal values have equal hashes. */
+uint32_t BigInt_hash(BigInt bigint);
 
 /** Write big integer. */
 SystemIoError BigInt_write(Writer* writer, BigInt bigint, int base);
@@ -0,0 +1,292 @@
+#undef NDEBUG
+
+#include "src/support/bigint.h"
+#include "src/support/array_writer.h"
+#include "src/support/malloc.h"
+
+#include <assert.h>
+#include <string.h>
+
+/* Sizes in hex digits of random operands, picked to cover inline values, a
+ * few limbs, and both sides of the Karatsuba and conversion thresholds. */
+static size_t const sizes[] = { 1, 8, 15, 16, 17, 40, 300, 1100, 2500 };
+
+#define SIZE_COUNT (sizeof(sizes) / sizeof(sizes[0]))
+
+static uint64_t random_state = 0x9E3779B97F4A7C15u;
+
+static uint64_t random_next(void) {
+    /* xorshift64 */
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+static BigInt random_bigint(Arena* arena, size_t digits, int is_negative) {
+    static char const hex[] = "0123456789ABCDEF";
+    ByteStringRef string;
+    char* data;
+    BigInt result;
+    size_t i;
+
+    data = xmalloc(digits);
+    for (i = 0; i < digits; i += 1) {
+        data[i] = hex[random_next() % 16];
+    }
+
+    string.data = data;
+    string.size = digits;
+    result = BigInt_parse(arena, string, 16);
+    xfree(data);
+
+    return is_negative ? BigInt_negate(arena, result) : result;
+}
+
+static int equal(BigInt a, BigInt b) {
+    return BigInt_compare(a, b) == 0;
+}
+
+static BigInt from_string(Arena* arena, char const* string, int base) {
+    ByteStringRef ref;
+    ref.data = string;
+    ref.size = strlen(string);
+    return BigInt_parse(arena, ref, base);
+}
+
+static void check_written(BigInt bigint, int base, char const* expected) {
+    ArrayWriter writer;
+
+    ArrayWriter_init(&writer);
+    BigInt_write(&writer.base, bigint, base);
+    assert(writer.size == strlen(expected));
+    assert(memcmp(writer.data, expected, writer.size) == 0);
+    ArrayWriter_destroy(&writer);
+}
+
+static void known_value_tests(Arena* arena) {
+    BigInt two_64;
+    BigInt x;
+    BigInt q;
+    BigInt r;
+
+    two_64 = BigInt_shift_left(arena, BigInt_from_int(arena, 1), 64);
+    check_written(two_64, 10, "18446744073709551616");
+    check_written(two_64, 16, "10000000000000000");
+    check_written(BigInt_negate(arena, two_64), 10, "-18446744073709551616");
+    assert(equal(two_64, from_string(arena, "18_446_744_073_709_551_616", 10)));
+
+    x = from_string(arena, "340282366920938463463374607431768211455", 10);
+    check_written(x, 16, "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF");
+    check_written(x, 2, "11111111111111111111111111111111"
+        "11111111111111111111111111111111"
+        "11111111111111111111111111111111"
+        "11111111111111111111111111111111");
+    assert(equal(
+        BigInt_add(arena, x, BigInt_from_int(arena, 1)),
+        BigInt_shift_left(arena, BigInt_from_int(arena, 1), 128)
+    ));
+
+    /* The edges of the inline range. */
+    check_written(BigInt_from_int(arena, BIGINT_INLINE_MIN), 10,
+        "-4611686018427387904");
+    check_written(
+        BigInt_sub(
+            arena,
+            BigInt_from_int(arena, BIGINT_INLINE_MIN),
+            BigInt_from_int(arena, 1)
+        ),
+        10,
+        "-4611686018427387905"
+    );
+    check_written(
+        BigInt_negate(arena, BigInt_from_int(arena, BIGINT_INLINE_MIN)),
+        10,
+        "4611686018427387904"
+    );
+    check_written(BigInt_from_uint(arena, UINT64_MAX), 10,
+        "18446744073709551615");
+    assert(BigInt_as_uint32(BigInt_from_int(arena, -1)) == UINT32_MAX);
+    assert(BigInt_as_uint32(BigInt_from_uint(arena, UINT64_MAX)) == UINT32_MAX);
+    assert(BigInt_as_uint32(BigInt_negate(arena, two_64)) == 0);
+
+    BigInt_divmod(
+        arena,
+        BigInt_from_int(arena, BIGINT_INLINE_MIN),
+        BigInt_from_int(arena, -1),
+        &q,
+        &r
+    );
+    check_written(q, 10, "4611686018427387904");
+    check_written(r, 10, "0");
+
+    /* Division truncates, shifts round down. */
+    BigInt_divmod(
+        arena, BigInt_from_int(arena, -7), BigInt_from_int(arena, 2), &q, &r
+    );
+    check_written(q, 10, "-3");
+    check_written(r, 10, "-1");
+    BigInt_divmod(
+        arena, BigInt_negate(arena, two_64), BigInt_from_int(arena, 3), &q, &r
+    );
+    check_written(q, 10, "-6148914691236517205");
+    check_written(r, 10, "-1");
+    check_written(
+        BigInt_shift_right(arena, BigInt_from_int(arena, -7), 1), 10, "-4"
+    );
+    check_written(
+        BigInt_shift_right(arena, BigInt_negate(arena, two_64), 100), 10, "-1"
+    );
+    check_written(
+        BigInt_shift_right(
+            arena,
+            BigInt_sub(arena, BigInt_negate(arena, two_64), two_64),
+            65
+        ),
+        10,
+        "-1"
+    );
+}
+
+static void small_value_tests(Arena* arena) {
+    int i;
+
+    for (i = 0; i < 100000; i += 1) {
+        int64_t x;
+        int64_t y;
+        BigInt a;
+        BigInt b;
+        BigInt q;
+        BigInt r;
+
+        /* 31-bit values, so every result fits int64_t. */
+        x = (int64_t)(random_next() % (UINT64_C(1) << 32)) - (INT64_C(1) << 31);
+        y = (int64_t)(random_next() % (UINT64_C(1) << 32)) - (INT64_C(1) << 31);
+        a = BigInt_from_int(arena, x);
+        b = BigInt_from_int(arena, y);
+
+        assert(equal(BigInt_add(arena, a, b), BigInt_from_int(arena, x + y)));
+        assert(equal(BigInt_sub(arena, a, b), BigInt_from_int(arena, x - y)));
+        assert(equal(BigInt_mul(arena, a, b), BigInt_from_int(arena, x * y)));
+        assert(BigInt_compare(a, b) == (x > y) - (x < y));
+
+        if (y != 0) {
+            BigInt_divmod(arena, a, b, &q, &r);
+            assert(equal(q, BigInt_from_int(arena, x / y)));
+            assert(equal(r, BigInt_from_int(arena, x % y)));
+        }
+    }
+}
+
+/* Identities on random values of every pair of sizes and signs. */
+static void identity_tests(Arena* arena) {
+    BigInt zero;
+    size_t i;
+    size_t j;
+    int signs;
+
+    zero = BigInt_from_int(arena, 0);
+
+    for (i = 0; i < SIZE_COUNT; i += 1) {
+        for (j = 0; j < SIZE_COUNT; j += 1) {
+            for (signs = 0; signs < 4; signs += 1) {
+                BigInt a;
+                BigInt b;
+                BigInt c;
+                BigInt product;
+                BigInt q;
+                BigInt r;
+                size_t shift;
+
+                a = random_bigint(arena, sizes[i], signs & 1);
+                b = random_bigint(arena, sizes[j], signs & 2);
+                c = random_bigint(arena, sizes[j], signs & 1);
+
+                assert(equal(
+                    BigInt_sub(arena, BigInt_add(arena, a, b), b), a
+                ));
+                assert(
+                    BigInt_compare(a, b)
+                    == BigInt_compare(BigInt_sub(arena, a, b), zero)
+                );
+                assert(BigInt_hash(a) == BigInt_hash(BigInt_copy(arena, a)));
+
+                /* a(b + c) = ab + ac */
+                product = BigInt_mul(arena, a, b);
+                assert(equal(
+                    BigInt_mul(arena, a, BigInt_add(arena, b, c)),
+                    BigInt_add(arena, product, BigInt_mul(arena, a, c))
+                ));
+
+                /* a = qb + r, and ab divides exactly by b. */
+                if (BigInt_compare(b, zero) != 0) {
+                    BigInt_divmod(arena, a, b, &q, &r);
+                    assert(equal(
+                        BigInt_add(arena, BigInt_mul(arena, q, b), r), a
+                    ));
+                    BigInt_divmod(arena, product, b, &q, &r);
+                    assert(equal(q, a));
+                    assert(equal(r, zero));
+                }
+
+                shift = random_next() % 200;
+                assert(equal(
+                    BigInt_shift_left(arena, a, shift),
+                    BigInt_mul(
+                        arena,
+                        a,
+                        BigInt_shift_left(
+                            arena, BigInt_from_int(arena, 1), shift
+                        )
+                    )
+                ));
+                assert(equal(
+                    BigInt_shift_right(
+                        arena, BigInt_shift_left(arena, a, shift), shift
+                    ),
+                    a
+                ));
+            }
+        }
+    }
+}
+
+/* Writing and parsing back in every base gives the same value. */
+static void round_trip_tests(Arena* arena) {
+    size_t i;
+    int base;
+
+    for (i = 0; i < SIZE_COUNT; i += 1) {
+        for (base = 2; base <= 36; base += 1) {
+            BigInt a;
+            ArrayWriter writer;
+            ByteStringRef string;
+
+            a = random_bigint(arena, sizes[i], false);
+
+            ArrayWriter_init(&writer);
+            BigInt_write(&writer.base, a, base);
+            assert(writer.size == 1 || writer.data[0] != '0');
+
+            string.data = (char const*)writer.data;
+            string.size = writer.size;
+            assert(equal(BigInt_parse(arena, string, base), a));
+
+            ArrayWriter_destroy(&writer);
+        }
+    }
+}
+
+int main(void) {
+    Arena arena;
+
+    Arena_init(&arena);
+
+    known_value_tests(&arena);
+    small_value_tests(&arena);
+    identity_tests(&arena);
+    round_trip_tests(&arena);
+
+    Arena_destroy(&arena);
+    return 0;
+}
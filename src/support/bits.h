@@ -0,0 +1,91 @@
+#ifndef _ZENO_SPEC_SRC_SUPPORT_BITS_H
+#define _ZENO_SPEC_SRC_SUPPORT_BITS_H
+
+#include "src/support/defs.h"
+#include "src/support/stdint.h"
+
+/* Bit helpers for SIMD scanning loops and big integer limbs. */
+
+/* SSE2 is used where available. Define ZENO_NO_SIMD to build the portable
+ * paths everywhere instead. */
+#if defined(__SSE2__) && !defined(ZENO_NO_SIMD)
+    #define HAVE_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+/** Index of the lowest set bit. `mask` must be non-zero. */
+static inline unsigned lowest_bit(unsigned mask) {
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    unsigned i = 0;
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        i += 1;
+    }
+    return i;
+#endif
+}
+
+/** Index of the highest set bit. `mask` must be non-zero. */
+static inline unsigned highest_bit(unsigned mask) {
+#if defined(__GNUC__)
+    return (sizeof(unsigned) * 8 - 1) - __builtin_clz(mask);
+#else
+    unsigned i = 0;
+    while ((mask >> 1) != 0) {
+        mask >>= 1;
+        i += 1;
+    }
+    return i;
+#endif
+}
+
+/*
+ * Portable SIMD within a 64-bit word, 8 bytes at a time.
+ */
+
+#define BYTES_01 UINT64_C(0x0101010101010101)
+#define BYTES_7F UINT64_C(0x7F7F7F7F7F7F7F7F)
+#define BYTES_80 UINT64_C(0x8080808080808080)
+
+/** Little-endian 8 bytes, so the first byte is the lowest. */
+static inline uint64_t load_word(uint8_t const* p) {
+    return (uint64_t)p[0]
+        | ((uint64_t)p[1] << 8)
+        | ((uint64_t)p[2] << 16)
+        | ((uint64_t)p[3] << 24)
+        | ((uint64_t)p[4] << 32)
+        | ((uint64_t)p[5] << 40)
+        | ((uint64_t)p[6] << 48)
+        | ((uint64_t)p[7] << 56);
+}
+
+/** Gather the high bit of each byte into an 8-bit mask. */
+static inline unsigned word_high_bits(uint64_t word) {
+    word = (word & BYTES_80) >> 7;
+    return (unsigned)((word * UINT64_C(0x0102040810204080)) >> 56);
+}
+
+/** High bit set exactly in the bytes of `word` equal to `byte`. */
+static inline uint64_t word_equal(uint64_t word, uint8_t byte) {
+    uint64_t x;
+    x = word ^ (BYTES_01 * byte);
+    return ~(((x & BYTES_7F) + BYTES_7F) | x | BYTES_7F);
+}
+
+/** Number of set bits. */
+static inline unsigned count_bits(unsigned mask) {
+#if defined(__GNUC__)
+    return __builtin_popcount(mask);
+#else
+    unsigned count = 0;
+    while (mask != 0) {
+        mask &= mask - 1;
+        count += 1;
+    }
+    return count;
+#endif
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "src/support/encoding.h"
+#include "src/support/bits.h"
 
 #define is_utf8_continuation(byte) (((byte) & 0xC0) == 0x80)
 
@@ -41,8 +42,13 @@ int32_t utf8_decode(uint8_t const** p_cursor, uint8_t const* limit) {
         return cursor[0];
 
     case 2:
-        return ((cursor[0] & 0x1F) << 6)
+        res = ((cursor[0] & 0x1F) << 6)
             | (cursor[1] & 0x3F);
+        if (res < 0x80) {
+            /* Overlong encoding. */
+            return U_BAD;
+        }
+        return res;
 
     case 3:
         res = ((cursor[0] & 0x0F) << 12)
@@ -63,6 +69,10 @@ int32_t utf8_decode(uint8_t const** p_cursor, uint8_t const* limit) {
             | ((cursor[1] & 0x3F) << 12)
             | ((cursor[2] & 0x3F) << 6)
             | (cursor[3] & 0x3F);
+        if (res < 0x10000) {
+            /* Overlong encoding. */
+            return U_BAD;
+        }
         if (res > 0x10FFFF) {
             /* Out of range. */
             return U_BAD;
@@ -70,3 +80,96 @@ int32_t utf8_decode(uint8_t const** p_cursor, uint8_t const* limit) {
         return res;
     }
 }
+
+/* Whether the 16 bytes at `p` are all ASCII. */
+static int is_ascii_block(uint8_t const* p) {
+#if HAVE_SSE2
+    return _mm_movemask_epi8(_mm_loadu_si128((__m128i const*)p)) == 0;
+#else
+    uint8_t bits = 0;
+    int i;
+    for (i = 0; i < 16; i += 1) {
+        bits |= p[i];
+    }
+    return (bits & 0x80) == 0;
+#endif
+}
+
+/*
+ * Length of the well-formed UTF-8 sequence starting with the non-ASCII byte
+ * at `p`, or 0 if there isn't one. Stops at the first byte that is not a
+ * valid continuation, so a nul terminator is never read past.
+ */
+static size_t well_formed_sequence_size(uint8_t const* p) {
+    uint8_t low = 0x80;
+    uint8_t high = 0xBF;
+    size_t size;
+    size_t i;
+
+    if (p[0] >= 0xC2 && p[0] <= 0xDF) {
+        size = 2;
+    } else if (p[0] >= 0xE0 && p[0] <= 0xEF) {
+        size = 3;
+        if (p[0] == 0xE0) {
+            /* Overlong */
+            low = 0xA0;
+        } else if (p[0] == 0xED) {
+            /* Surrogate */
+            high = 0x9F;
+        }
+    } else if (p[0] >= 0xF0 && p[0] <= 0xF4) {
+        size = 4;
+        if (p[0] == 0xF0) {
+            /* Overlong */
+            low = 0x90;
+        } else if (p[0] == 0xF4) {
+            /* Above U+10FFFF */
+            high = 0x8F;
+        }
+    } else {
+        return 0;
+    }
+
+    if (p[1] < low || p[1] > high) {
+        return 0;
+    }
+
+    for (i = 2; i < size; i += 1) {
+        if (!is_utf8_continuation(p[i])) {
+            return 0;
+        }
+    }
+
+    return size;
+}
+
+size_t utf8_valid_prefix_size(uint8_t const* data, size_t size) {
+    uint8_t const* cursor;
+    uint8_t const* limit;
+
+    cursor = data;
+    limit = data + size;
+
+    for (;;) {
+        size_t sequence_size;
+
+        while (limit - cursor >= 16 && is_ascii_block(cursor)) {
+            cursor += 16;
+        }
+
+        if (cursor == limit) {
+            return size;
+        }
+
+        if (cursor[0] < 0x80) {
+            cursor += 1;
+            continue;
+        }
+
+        sequence_size = well_formed_sequence_size(cursor);
+        if (sequence_size == 0 || sequence_size > (size_t)(limit - cursor)) {
+            return cursor - data;
+        }
+        cursor += sequence_size;
+    }
+}
@@ -3,10 +3,19 @@
 
 #include "src/support/stdint.h"
 
+#include <stddef.h>
+
 #define U_EOF -1
 #define U_BAD -2
 
 /** Decode one UTF-8 character. Updates `cursor` with new location. */
 int32_t utf8_decode(uint8_t const** cursor, uint8_t const* limit);
 
+/**
+ * Length of the longest prefix that `utf8_decode` decodes without error. Like
+ * `utf8_decode`, this may read the byte at `data[size]`, which must be a nul
+ * terminator.
+ */
+size_t utf8_valid_prefix_size(uint8_t const* data, size_t size);
+
 #endif
@@ -1,9 +1,61 @@
 #include "src/support/hash_map.h"
+#include "src/support/bits.h"
 #include "src/support/malloc.h"
 
 #include <assert.h>
 #include <string.h>
 
+/*
+ * Control bytes
+ */
+
+#define GROUP_SIZE 16
+
+/* Control byte of an empty bucket. Full buckets have the high bit clear. */
+#define CONTROL_EMPTY 0x80
+
+/* Bucket position comes from the low bits of the hash and the control byte
+ * from the top 7 bits, so they are independent. */
+#define HASH_TAG(hash) ((uint8_t)((hash) >> 25))
+
+#if HAVE_SSE2
+
+/* Bit mask of the group's control bytes equal to `tag`. */
+static unsigned group_match(uint8_t const* control, uint8_t tag) {
+    __m128i group;
+    group = _mm_loadu_si128((__m128i const*)control);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag)));
+}
+
+/* Bit mask of the group's empty buckets. */
+static unsigned group_match_empty(uint8_t const* control) {
+    return _mm_movemask_epi8(_mm_loadu_si128((__m128i const*)control));
+}
+
+#else
+
+/* Portable version processing 8 control bytes per 64-bit word. */
+
+static unsigned word_match(uint64_t word, uint8_t tag) {
+    return word_high_bits(word_equal(word, tag));
+}
+
+static unsigned group_match(uint8_t const* control, uint8_t tag) {
+    return word_match(load_word(control), tag)
+        | (word_match(load_word(control + 8), tag) << 8);
+}
+
+static unsigned group_match_empty(uint8_t const* control) {
+    return word_high_bits(load_word(control))
+        | (word_high_bits(load_word(control + 8)) << 8);
+}
+
+#endif
+
+/*
+ * Buckets and entries
+ */
+
 static void* get_entry_from_id(
     HashMap const* map, HashMapConfig const* config, uint32_t id
 ) {
@@ -23,7 +75,9 @@ static uint32_t get_id_from_bucket(HashMap const* map, uint32_t bucket) {
     }
 }
 
-static void set_bucket_id(HashMap* map, uint32_t bucket, uint32_t id) {
+static void set_bucket(
+    HashMap* map, uint32_t bucket, uint32_t id, uint32_t hash
+) {
     if (map->buckets_count < UINT8_MAX) {
         ((uint8_t*)map->buckets)[bucket] = id;
     } else if (map->buckets_count < UINT16_MAX) {
@@ -31,61 +85,106 @@ static void set_bucket_id(HashMap* map, uint32_t bucket, uint32_t id) {
     } else {
         ((uint32_t*)map->buckets)[bucket] = id;
     }
+
+    map->control[bucket] = HASH_TAG(hash);
+
+    /* Mirror the first group past the end so groups never wrap. */
+    if (bucket < GROUP_SIZE) {
+        map->control[map->buckets_count + bucket] = HASH_TAG(hash);
+    }
 }
 
+/*
+ * Probing visits groups of GROUP_SIZE buckets. Entries are never removed, so
+ * a key is always found before the first empty bucket in its probe sequence.
+ */
 static uint32_t get_internal(
     HashMap const* map,
     HashMapConfig const* config,
     char const* key,
+    uint32_t hash,
     uint32_t* out_bucket
 ) {
-    uint32_t hash;
-    uint32_t id;
-    uint32_t bucket;
+    uint32_t mask;
+    uint32_t pos;
+    uint8_t tag;
 
-    hash = config->hash(key);
-    bucket = hash % map->buckets_count;
+    mask = map->buckets_count - 1;
+    pos = hash & mask;
+    tag = HASH_TAG(hash);
 
     for (;;) {
-        uint32_t entry_hash;
-        char const* entry;
-
-        if (bucket == map->buckets_count) {
-            /* Roll over. */
-            bucket = 0;
+        uint8_t const* group;
+        unsigned matches;
+        unsigned empties;
+
+        group = map->control + pos;
+        matches = group_match(group, tag);
+
+        while (matches != 0) {
+            uint32_t id;
+            id = get_id_from_bucket(map, (pos + lowest_bit(matches)) & mask);
+            if (
+                map->hashes[id - 1] == hash
+                && config->equal(key, get_entry_from_id(map, config, id))
+            ) {
+                return id;
+            }
+            matches &= matches - 1;
         }
 
-        id = get_id_from_bucket(map, bucket);
+        empties = group_match_empty(group);
 
-        if (id == 0) {
+        if (empties != 0) {
             if (out_bucket != NULL) {
-                *out_bucket = bucket;
+                *out_bucket = (pos + lowest_bit(empties)) & mask;
             }
             return 0;
         }
 
-        entry = get_entry_from_id(map, config, id);
-        entry_hash = config->hash(entry);
+        pos = (pos + GROUP_SIZE) & mask;
+    }
+}
+
+/* Find the empty bucket for an entry known not to be in the table. */
+static uint32_t get_empty_bucket(HashMap const* map, uint32_t hash) {
+    uint32_t mask;
+    uint32_t pos;
+
+    mask = map->buckets_count - 1;
+    pos = hash & mask;
+
+    for (;;) {
+        unsigned empties;
 
-        if (entry_hash == hash && config->equal(key, entry)) {
-            return id;
+        empties = group_match_empty(map->control + pos);
+
+        if (empties != 0) {
+            return (pos + lowest_bit(empties)) & mask;
         }
 
-        bucket += 1;
+        pos = (pos + GROUP_SIZE) & mask;
     }
 }
 
-static void reset_buckets(HashMap* map) {
+static void allocate_buckets(HashMap* map) {
     if (map->buckets_count < UINT8_MAX) {
-        memset(map->buckets, 0, map->buckets_count);
+        map->buckets = xallocarray(map->buckets_count, 1);
     } else if (map->buckets_count < UINT16_MAX) {
-        memset(map->buckets, 0, map->buckets_count * 2);
+        map->buckets = xallocarray(map->buckets_count, 2);
     } else {
-        memset(map->buckets, 0, map->buckets_count * 4);
+        map->buckets = xallocarray(map->buckets_count, 4);
     }
+
+    map->control = xmalloc(map->buckets_count + GROUP_SIZE);
 }
 
-static void maybe_resize(HashMap* map, HashMapConfig const* config) {
+static void reset_buckets(HashMap* map) {
+    /* Bucket IDs are only read after a control byte match. */
+    memset(map->control, CONTROL_EMPTY, map->buckets_count + GROUP_SIZE);
+}
+
+static void maybe_resize(HashMap* map) {
     uint32_t id;
 
     /* 75% load factor */
@@ -97,42 +196,36 @@ static void maybe_resize(HashMap* map, HashMapConfig const* config) {
     map->buckets_count = map->buckets_count * 2;
 
     xfree(map->buckets);
-
-    if (map->buckets_count < UINT8_MAX) {
-        map->buckets = xallocarray(map->buckets_count, 1);
-    } else if (map->buckets_count < UINT16_MAX) {
-        map->buckets = xallocarray(map->buckets_count, 2);
-    } else {
-        map->buckets = xallocarray(map->buckets_count, 4);
-    }
-
+    xfree(map->control);
+    allocate_buckets(map);
     reset_buckets(map);
 
     for (id = 1; id <= map->entries_count; id += 1) {
-        char* entry;
-        uint32_t existing_id;
-        uint32_t bucket;
-        entry = get_entry_from_id(map, config, id);
-        existing_id = get_internal(map, config, entry, &bucket);
-        assert(existing_id == 0);
-        set_bucket_id(map, bucket, id);
+        uint32_t hash;
+        hash = map->hashes[id - 1];
+        set_bucket(map, get_empty_bucket(map, hash), id, hash);
     }
 }
 
 void HashMap_init(HashMap* map, HashMapConfig const* config) {
     map->entries_count = 0;
     map->entries_capacity = 16;
+
+    /* Must be a power of two and at least GROUP_SIZE. */
     map->buckets_count = 16;
 
     map->entries = xallocarray(config->entry_size, map->entries_capacity);
+    map->hashes = xallocarray(sizeof(uint32_t), map->entries_capacity);
 
-    map->buckets = xmalloc(map->buckets_count);
-    memset(map->buckets, 0, map->buckets_count);
+    allocate_buckets(map);
+    reset_buckets(map);
 }
 
 void HashMap_destroy(HashMap* map) {
     xfree(map->entries);
+    xfree(map->hashes);
     xfree(map->buckets);
+    xfree(map->control);
 }
 
 void HashMap_reset(HashMap* map) {
@@ -140,50 +233,86 @@ void HashMap_reset(HashMap* map) {
     reset_buckets(map);
 }
 
-uint32_t HashMap_set(
+uint32_t HashMap_get_or_insert(
     HashMap* map,
     HashMapConfig const* config,
     void const* key,
-    void const* value
+    int* out_inserted,
+    void** out_key,
+    void** out_value
 ) {
+    uint32_t hash;
     uint32_t id;
     uint32_t bucket;
     char* entry;
+    int inserted;
 
-    id = get_internal(map, config, key, &bucket);
+    hash = config->hash(key);
+    id = get_internal(map, config, key, hash, &bucket);
+    inserted = id == 0;
+
+    if (inserted) {
+        id = map->entries_count + 1;
+
+        if (map->entries_count == map->entries_capacity) {
+            /* Expand entries array. 1.5x growth rate. */
+            /* FIXME: overflow */
+            map->entries_capacity += map->entries_capacity / 2;
+            map->entries = xreallocarray(
+                map->entries, config->entry_size, map->entries_capacity
+            );
+            map->hashes = xreallocarray(
+                map->hashes, sizeof(uint32_t), map->entries_capacity
+            );
+        }
 
-    if (id != 0) {
+        /* Create entry. */
+        entry = get_entry_from_id(map, config, id);
+        memcpy(entry, key, config->key_size);
         if (config->value_size > 0) {
-            entry = get_entry_from_id(map, config, id);
-            memcpy(entry + config->value_offset, value, config->value_size);
+            memset(entry + config->value_offset, 0, config->value_size);
         }
-        return id;
-    }
+        map->hashes[id - 1] = hash;
+        map->entries_count += 1;
 
-    id = map->entries_count + 1;
+        /* Set bucket. */
+        set_bucket(map, bucket, id, hash);
 
-    if (map->entries_count == map->entries_capacity) {
-        /* Expand entries array. 1.5x growth rate. */
-        /* FIXME: overflow */
-        map->entries_capacity += map->entries_capacity / 2;
-        map->entries = xreallocarray(
-            map->entries, config->entry_size, map->entries_capacity
-        );
+        /* Resize if load factor exceeded. */
+        maybe_resize(map);
     }
 
-    /* Create entry. */
     entry = get_entry_from_id(map, config, id);
-    memcpy(entry, key, config->key_size);
-    if (config->value_size > 0) {
-        memcpy(entry + config->value_offset, value, config->value_size);
+
+    if (out_inserted != NULL) {
+        *out_inserted = inserted;
     }
-    map->entries_count += 1;
+    if (out_key != NULL) {
+        *out_key = entry;
+    }
+    if (out_value != NULL) {
+        *out_value = config->value_size > 0
+            ? entry + config->value_offset
+            : NULL;
+    }
+
+    return id;
+}
 
-    /* Set bucket. */
-    set_bucket_id(map, bucket, id);
+uint32_t HashMap_set(
+    HashMap* map,
+    HashMapConfig const* config,
+    void const* key,
+    void const* value
+) {
+    uint32_t id;
+    void* entry_value;
+
+    id = HashMap_get_or_insert(map, config, key, NULL, NULL, &entry_value);
 
-    /* Resize if load factor exceeded. */
-    maybe_resize(map, config);
+    if (config->value_size > 0) {
+        memcpy(entry_value, value, config->value_size);
+    }
 
     return id;
 }
@@ -191,7 +320,7 @@ uint32_t HashMap_set(
 uint32_t HashMap_get_id_by_key(
     HashMap const* map, HashMapConfig const* config, void const* key
 ) {
-    return get_internal(map, config, key, NULL);
+    return get_internal(map, config, key, config->hash(key), NULL);
 }
 
 void const* HashMap_get_value_by_key(
@@ -200,7 +329,7 @@ void const* HashMap_get_value_by_key(
     uint32_t id;
     char const* entry;
 
-    id = get_internal(map, config, key, NULL);
+    id = get_internal(map, config, key, config->hash(key), NULL);
 
     if (id == 0) {
         return NULL;
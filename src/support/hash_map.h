@@ -11,9 +11,15 @@
  * - Append-only, no removals.
  * - All entries have a unique 32-bit ID and can be looked up by it.
  * - Zero ID is reserved and invalid.
- * - `indexes` is a compact hash table that uses uint{8,16,32}_t indexes
+ * - `buckets` is a compact hash table that uses uint{8,16,32}_t indexes
  *   based on the size of the table.
+ * - `control` has one byte per bucket: empty, or the top 7 bits of the hash
+ *   of the bucket's entry. Lookups compare 16 control bytes at a time (with
+ *   SSE2 unless ZENO_NO_SIMD is defined) and only read the index and the
+ *   entry on a match.
  * - `entries` is a densely packed array of key-value entries, indexed by ID.
+ * - `hashes` stores the hash of each entry, indexed by ID. Probes compare it
+ *   before touching the entry and resizing never calls the hash function.
  */
 
 typedef struct HashMapConfig {
@@ -40,7 +46,9 @@ typedef struct HashMapConfig {
 
 typedef struct HashMap {
     char* entries;
+    uint32_t* hashes;
     void* buckets;
+    uint8_t* control;
     uint32_t entries_count;
     uint32_t entries_capacity;
     uint32_t buckets_count;
@@ -59,6 +67,24 @@ uint32_t HashMap_set(
     void const* value
 );
 
+/*
+ * Get the ID of `key`, adding a new entry if it is not present, using a single
+ * table probe. Sets `*out_inserted` to whether an entry was added, and
+ * `*out_key` and `*out_value` to the stored key and value so the caller can
+ * fill them in place. A new entry's key is a copy of `key` and its value is
+ * zero-filled. The stored key may only be changed in ways that keep it equal
+ * to `key` with the same hash. Pointers are valid until the next insertion.
+ * Any of the out-parameters may be NULL.
+ */
+uint32_t HashMap_get_or_insert(
+    HashMap* map,
+    HashMapConfig const* config,
+    void const* key,
+    int* out_inserted,
+    void** out_key,
+    void** out_value
+);
+
 uint32_t HashMap_get_id_by_key(
     HashMap const* map, HashMapConfig const* config, void const* key
 );
@@ -1,9 +1,15 @@
 #undef NDEBUG
 
 #include "src/support/hash_map.h"
+#include "src/support/array_writer.h"
+#include "src/support/bench_input.h"
 #include "src/support/fnv1a.h"
+#include "src/support/io.h"
+#include "src/support/malloc.h"
 
 #include <assert.h>
+#include <string.h>
+#include <time.h>
 
 /* These types are chosen so that Value has a greater alignment than Key. */
 typedef uint16_t Key;
@@ -162,7 +168,317 @@ static void tests(HashMapConfig const* config, int is_map) {
     HashMap_destroy(&map);
 }
 
-int main(void) {
+static void get_or_insert_tests(HashMapConfig const* config, int is_map) {
+    HashMap map;
+    Key key;
+    uint32_t id = 1;
+
+    HashMap_init(&map, config);
+
+    for (key = 0; key < KEY_MAX; key += KEY_INCREMENT) {
+        uint32_t actual_id;
+        int inserted;
+        void* p_key;
+        void* p_value;
+        Value value;
+
+        value = key * 3;
+
+        /* Insert new entry and fill in value. */
+        actual_id = HashMap_get_or_insert(
+            &map, config, &key, &inserted, &p_key, &p_value
+        );
+        assert(actual_id == id);
+        assert(inserted);
+        assert(*(Key*)p_key == key);
+        if (is_map) {
+            assert(p_value != NULL);
+            assert(*(Value*)p_value == 0);
+            *(Value*)p_value = value;
+        } else {
+            assert(p_value == NULL);
+        }
+
+        check_entry(&map, config, is_map, id, key, value);
+
+        /* Get existing entry. */
+        actual_id = HashMap_get_or_insert(
+            &map, config, &key, &inserted, &p_key, &p_value
+        );
+        assert(actual_id == id);
+        assert(!inserted);
+        assert(p_key == HashMap_get_key_by_id(&map, config, id));
+        assert(p_value == HashMap_get_value_by_id(&map, config, id));
+
+        /* Out-parameters are optional. */
+        actual_id = HashMap_get_or_insert(&map, config, &key, NULL, NULL, NULL);
+        assert(actual_id == id);
+
+        id += 1;
+    }
+
+    HashMap_destroy(&map);
+}
+
+/*
+ * Benchmark, run with `--bench`. Uses string keys whose hash is not cached,
+ * so hash function calls are counted along with the time.
+ */
+
+#define BENCH_COUNT 500000
+
+static unsigned long bench_hash_calls;
+
+static uint32_t bench_hash(void const* key) {
+    bench_hash_calls += 1;
+    return StringRef_hash(*(StringRef const*)key);
+}
+
+static StringRef* make_bench_keys(ArrayWriter* writer, char const* prefix) {
+    StringRef* keys;
+    size_t* ends;
+    uint32_t i;
+
+    keys = xallocarray(BENCH_COUNT, sizeof(StringRef));
+    ends = xallocarray(BENCH_COUNT, sizeof(size_t));
+
+    for (i = 0; i < BENCH_COUNT; i += 1) {
+        Writer_format(&writer->base, "%s_%u", prefix, i);
+        ends[i] = writer->size;
+    }
+
+    /* Point into the buffer only after it stops moving. */
+    for (i = 0; i < BENCH_COUNT; i += 1) {
+        size_t start;
+        start = i == 0 ? 0 : ends[i - 1];
+        keys[i].data = writer->data + start;
+        keys[i].size = ends[i] - start;
+    }
+
+    xfree(ends);
+    return keys;
+}
+
+static void report_bench(char const* name, clock_t start) {
+    unsigned long ms;
+    ms = (unsigned long)(clock() - start) * 1000 / CLOCKS_PER_SEC;
+    Writer_format(
+        Writer_stdout,
+        "%s: %u ms, %u hash calls\n",
+        name,
+        (unsigned)ms,
+        (unsigned)bench_hash_calls
+    );
+    bench_hash_calls = 0;
+}
+
+static void bench(void) {
+    static HashMapConfig const config = HASH_MAP_CONFIG(
+        StringRef, uint32_t, bench_hash, StringRef_equal_generic
+    );
+    ArrayWriter hit_writer;
+    ArrayWriter miss_writer;
+    StringRef* hit_keys;
+    StringRef* miss_keys;
+    HashMap map;
+    clock_t start;
+    uint32_t i;
+
+    ArrayWriter_init(&hit_writer);
+    ArrayWriter_init(&miss_writer);
+    hit_keys = make_bench_keys(&hit_writer, "name");
+    miss_keys = make_bench_keys(&miss_writer, "miss");
+
+    HashMap_init(&map, &config);
+
+    start = clock();
+    for (i = 0; i < BENCH_COUNT; i += 1) {
+        HashMap_set(&map, &config, &hit_keys[i], &i);
+    }
+    report_bench("insert", start);
+
+    start = clock();
+    for (i = 0; i < BENCH_COUNT; i += 1) {
+        uint32_t id;
+        id = HashMap_get_id_by_key(&map, &config, &hit_keys[i]);
+        assert(id == i + 1);
+    }
+    report_bench("lookup hit", start);
+
+    start = clock();
+    for (i = 0; i < BENCH_COUNT; i += 1) {
+        uint32_t id;
+        id = HashMap_get_id_by_key(&map, &config, &miss_keys[i]);
+        assert(id == 0);
+    }
+    report_bench("lookup miss", start);
+
+    HashMap_destroy(&map);
+    xfree(hit_keys);
+    xfree(miss_keys);
+    ArrayWriter_destroy(&hit_writer);
+    ArrayWriter_destroy(&miss_writer);
+}
+
+/*
+ * Hash function benchmark, run with `--bench-hash FILE...`. Compares string
+ * hashes on the unique identifiers found in the files.
+ */
+
+#define HASH_BENCH_ROUNDS 1000
+
+typedef struct HashFunction {
+    char const* name;
+    uint32_t (*hash)(StringRef string);
+} HashFunction;
+
+static uint32_t uint32_hash(void const* key) {
+    return *(uint32_t const*)key;
+}
+
+static int uint32_equal(void const* key1, void const* key2) {
+    return *(uint32_t const*)key1 == *(uint32_t const*)key2;
+}
+
+static void bench_hash_function(
+    HashFunction const* function, HashMap const* set, HashMapConfig const* config
+) {
+    static HashMapConfig const hash_set_config =
+        HASH_SET_CONFIG(uint32_t, uint32_hash, uint32_equal);
+    HashMap hash_set;
+    uint32_t count;
+    uint32_t buckets_count;
+    uint8_t* buckets;
+    uint32_t bucket_collisions = 0;
+    uint32_t expected_collisions;
+    unsigned long bytes = 0;
+    unsigned long ms;
+    uint32_t sum = 0;
+    clock_t start;
+    uint32_t id;
+    int round;
+
+    count = set->entries_count;
+
+    /* Throughput */
+    start = clock();
+    for (round = 0; round < HASH_BENCH_ROUNDS; round += 1) {
+        for (id = 1; id <= count; id += 1) {
+            StringRef const* identifier;
+            identifier = HashMap_get_key_by_id(set, config, id);
+            sum += function->hash(*identifier);
+            if (round == 0) {
+                bytes += identifier->size;
+            }
+        }
+    }
+    ms = (unsigned long)(clock() - start) * 1000 / CLOCKS_PER_SEC;
+
+    /* Distribution over the low bits, as used for bucket positions, in a
+     * table at most half full. */
+    buckets_count = 16;
+    while (buckets_count < count * 2) {
+        buckets_count *= 2;
+    }
+    buckets = xmalloc(buckets_count);
+    memset(buckets, 0, buckets_count);
+
+    HashMap_init(&hash_set, &hash_set_config);
+
+    for (id = 1; id <= count; id += 1) {
+        StringRef const* identifier;
+        uint32_t hash;
+        identifier = HashMap_get_key_by_id(set, config, id);
+        hash = function->hash(*identifier);
+        if (buckets[hash & (buckets_count - 1)]) {
+            bucket_collisions += 1;
+        }
+        buckets[hash & (buckets_count - 1)] = 1;
+        HashMap_set(&hash_set, &hash_set_config, &hash, NULL);
+    }
+
+    /* Expected for a random function: count - buckets * P(bucket used). */
+    {
+        double empty = 1.0;
+        uint32_t i;
+        for (i = 0; i < count; i += 1) {
+            empty *= 1.0 - 1.0 / buckets_count;
+        }
+        expected_collisions =
+            (uint32_t)(count - buckets_count * (1.0 - empty) + 0.5);
+    }
+
+    Writer_format(
+        Writer_stdout,
+        "%s: %u ms, %u MB/s, %u bucket collisions (random: %u), "
+        "%u full collisions (checksum %x)\n",
+        function->name,
+        (unsigned)ms,
+        (unsigned)(ms == 0 ? 0 : bytes * HASH_BENCH_ROUNDS / ms / 1000),
+        (unsigned)bucket_collisions,
+        (unsigned)expected_collisions,
+        (unsigned)(count - hash_set.entries_count),
+        (unsigned)sum
+    );
+
+    HashMap_destroy(&hash_set);
+    xfree(buckets);
+}
+
+static void bench_hash_functions(int path_count, char** paths) {
+    static HashMapConfig const config = HASH_SET_CONFIG(
+        StringRef, StringRef_hash_generic, StringRef_equal_generic
+    );
+    static HashFunction const functions[] = {
+        { "fnv1a", StringRef_hash_fnv1a },
+        { "wyhash", StringRef_hash }
+    };
+    uint8_t** files;
+    StringRef* identifiers = NULL;
+    size_t identifiers_size = 0;
+    size_t identifiers_capacity = 0;
+    HashMap set;
+    size_t j;
+    int i;
+
+    files = xallocarray(path_count, sizeof(uint8_t*));
+    HashMap_init(&set, &config);
+
+    for (i = 0; i < path_count; i += 1) {
+        size_t size;
+        files[i] = read_bench_file(paths[i], &size);
+        if (files[i] != NULL) {
+            identifiers = collect_identifiers(
+                identifiers,
+                &identifiers_size,
+                &identifiers_capacity,
+                files[i],
+                size
+            );
+        }
+    }
+
+    for (j = 0; j < identifiers_size; j += 1) {
+        HashMap_set(&set, &config, &identifiers[j], NULL);
+    }
+    xfree(identifiers);
+
+    Writer_format(
+        Writer_stdout, "%u unique identifiers\n", (unsigned)set.entries_count
+    );
+
+    for (i = 0; i < (int)(sizeof(functions) / sizeof(functions[0])); i += 1) {
+        bench_hash_function(&functions[i], &set, &config);
+    }
+
+    HashMap_destroy(&set);
+    for (i = 0; i < path_count; i += 1) {
+        xfree(files[i]);
+    }
+    xfree(files);
+}
+
+int main(int argc, char** argv) {
     static HashMapConfig const map_config =
         HASH_MAP_CONFIG(Key, Value, key_hash, key_equal);
 
@@ -175,11 +491,27 @@ int main(void) {
     static HashMapConfig const terrible_set_config =
         HASH_SET_CONFIG(Key, terrible_hash, key_equal);
 
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        bench();
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--bench-hash") == 0) {
+        bench_hash_functions(argc - 2, argv + 2);
+        return 0;
+    }
+
     tests(&map_config, true);
     tests(&terrible_map_config, true);
 
     tests(&set_config, false);
     tests(&terrible_set_config, false);
 
+    get_or_insert_tests(&map_config, true);
+    get_or_insert_tests(&terrible_map_config, true);
+
+    get_or_insert_tests(&set_config, false);
+    get_or_insert_tests(&terrible_set_config, false);
+
     return 0;
 }
@@ -1,6 +1,7 @@
 #include "src/support/io.h"
 #include "src/support/malloc.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 SystemIoError Writer_write_str(Writer* writer, StringRef string) {
@@ -15,12 +16,82 @@ SystemIoError Writer_write_bstr(Writer* writer, ByteStringRef string) {
     return writer->write(writer, string.data, string.size);
 }
 
+/*
+ * Buffered file writer.
+ */
+
+static SystemIoError FileWriter_flush(Writer* base_writer) {
+    FileWriter* writer;
+    SystemIoError res;
+
+    writer = (FileWriter*)base_writer;
+
+    if (writer->size == 0) {
+        return SystemIoError_Success;
+    }
+
+    res = SystemFile_write(writer->system_file, writer->buffer, writer->size);
+    writer->size = 0;
+    return res;
+}
+
+static void flush_standard_writers(void) {
+    Writer_flush(Writer_stdout);
+    Writer_flush(Writer_stderr);
+}
+
 static SystemIoError FileWriter_write(
-    Writer* writer, void const* data, size_t size
+    Writer* base_writer, void const* data, size_t size
 ) {
-    SystemFile system_file;
-    system_file = ((FileWriter*)writer)->system_file;
-    return SystemFile_write(system_file, data, size);
+    static int registered_atexit = false;
+    FileWriter* writer;
+    SystemIoError res;
+
+    writer = (FileWriter*)base_writer;
+
+    if (size == 0) {
+        return SystemIoError_Success;
+    }
+
+    if (!registered_atexit) {
+        registered_atexit = true;
+        atexit(flush_standard_writers);
+    }
+
+    if (writer->buffering == FileWriterBuffering_Auto) {
+        writer->buffering = SystemFile_isatty(writer->system_file)
+            ? FileWriterBuffering_Line
+            : FileWriterBuffering_Full;
+    }
+
+    if (writer->capacity - writer->size < size) {
+        res = FileWriter_flush(base_writer);
+        if (res != SystemIoError_Success) {
+            return res;
+        }
+
+        /* Too big to buffer. */
+        if (size >= writer->capacity) {
+            return SystemFile_write(writer->system_file, data, size);
+        }
+    }
+
+    memcpy(writer->buffer + writer->size, data, size);
+    writer->size += size;
+
+    if (
+        writer->buffering == FileWriterBuffering_Line
+        && memchr(data, '\n', size) != NULL
+    ) {
+        return FileWriter_flush(base_writer);
+    }
+
+    return SystemIoError_Success;
+}
+
+void FileWriter_set_buffering(Writer* writer, FileWriterBuffering buffering) {
+    Writer_flush(writer);
+    ((FileWriter*)writer)->buffering = buffering;
 }
 
 SystemIoError SystemFile_read_all(SystemFile file, void** data, size_t* size) {
@@ -41,7 +112,7 @@ SystemIoError SystemFile_read_all(SystemFile file, void** data, size_t* size) {
         }
 
         res = SystemFile_read(
-            file, (char*)*data + *size, sizeof(capacity - *size), &chunk_read
+            file, (char*)*data + *size, capacity - *size, &chunk_read
         );
 
         if (res != SystemIoError_Success) {
@@ -73,6 +144,7 @@ SystemIoError SystemFile_read_all(SystemFile file, void** data, size_t* size) {
 #include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 SystemIoError SystemFile_read(
@@ -165,18 +237,91 @@ SystemIoError SystemFile_open_read(SystemFile* file, char const* path) {
     return 0;
 }
 
+SystemIoError SystemFile_load_all(
+    SystemFile file, void const** data, size_t* size, int* is_mapped
+) {
+    struct stat statbuf;
+    size_t file_size;
+    long page_size;
+    SystemIoError res;
+    char* buffer;
+
+    *is_mapped = false;
+
+    /* Stream pipes, terminals, and files not read from the start. */
+    if (
+        fstat(file, &statbuf) != 0
+        || !S_ISREG(statbuf.st_mode)
+        || lseek(file, 0, SEEK_CUR) != 0
+    ) {
+        return SystemFile_read_all(file, (void**)data, size);
+    }
+
+    file_size = statbuf.st_size;
+    page_size = sysconf(_SC_PAGESIZE);
+
+    /* The rest of the last mapped page is zero-filled, which gives us the
+     * nul terminator as long as the size is not a multiple of the page. */
+    if (file_size > 0 && page_size > 0 && file_size % page_size != 0) {
+        void* mapped;
+        mapped = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapped != MAP_FAILED) {
+            *data = mapped;
+            *size = file_size;
+            *is_mapped = true;
+            return SystemIoError_Success;
+        }
+    }
+
+    /* Otherwise read exactly the size in one go. */
+    /* FIXME: overflow */
+    buffer = xmalloc(file_size + 1);
+
+    res = SystemFile_read(file, buffer, file_size, size);
+
+    if (res != SystemIoError_Success) {
+        xfree(buffer);
+        return res;
+    }
+
+    buffer[*size] = 0;
+    *data = buffer;
+    return SystemIoError_Success;
+}
+
+void SystemFile_unload_all(void const* data, size_t size, int is_mapped) {
+    if (is_mapped) {
+        munmap((void*)data, size);
+    } else {
+        xfree((void*)data);
+    }
+}
+
 int SystemFile_isatty(SystemFile file) {
     return isatty(file);
 }
 
+static uint8_t stdout_buffer[8192];
+static uint8_t stderr_buffer[1024];
+
 FileWriter FileWriter_stdout = {
-    {FileWriter_write},
-    SystemFile_stdout
+    {FileWriter_write, FileWriter_flush},
+    SystemFile_stdout,
+    FileWriterBuffering_Auto,
+    stdout_buffer,
+    0,
+    sizeof(stdout_buffer)
 };
 
 FileWriter FileWriter_stderr = {
-    {FileWriter_write},
-    SystemFile_stderr
+    {FileWriter_write, FileWriter_flush},
+    SystemFile_stderr,
+    /* Diagnostics go out a line at a time even when redirected, so none are
+     * lost to an abort. */
+    FileWriterBuffering_Line,
+    stderr_buffer,
+    0,
+    sizeof(stderr_buffer)
 };
 
 Writer* const Writer_stdout = &FileWriter_stdout.base;
@@ -41,8 +41,20 @@ SystemIoError SystemFile_close(SystemFile file);
 
 int SystemFile_isatty(SystemFile file);
 
+/** Read until EOF into a new nul-terminated buffer. Free with xfree. */
 SystemIoError SystemFile_read_all(SystemFile file, void** data, size_t* size);
 
+/**
+ * Load the whole file into nul-terminated memory. Regular files are mapped
+ * when possible, other files are read with `SystemFile_read_all`. Release
+ * with `SystemFile_unload_all`, passing the returned `is_mapped`.
+ */
+SystemIoError SystemFile_load_all(
+    SystemFile file, void const** data, size_t* size, int* is_mapped
+);
+
+void SystemFile_unload_all(void const* data, size_t size, int is_mapped);
+
 /*
  * Writer interface.
  */
@@ -53,17 +65,33 @@ typedef struct Writer {
         void const* data,
         size_t size
     );
+    /* Nullable if the writer has no buffering. */
+    SystemIoError (*flush)(struct Writer* writer);
 } Writer;
 
+typedef enum FileWriterBuffering {
+    /* Decided on first write: line buffered for terminals, else full. */
+    FileWriterBuffering_Auto,
+    FileWriterBuffering_Full,
+    FileWriterBuffering_Line
+} FileWriterBuffering;
+
+/** Buffered writer for a system file. Standard writers are flushed at exit. */
 typedef struct FileWriter {
     Writer base;
     SystemFile system_file;
-    /* TODO: buffering */
+    FileWriterBuffering buffering;
+    uint8_t* buffer;
+    size_t size;
+    size_t capacity;
 } FileWriter;
 
 extern Writer* const Writer_stdout;
 extern Writer* const Writer_stderr;
 
+/** Set buffering mode for a standard writer. */
+void FileWriter_set_buffering(Writer* writer, FileWriterBuffering buffering);
+
 /** Write byte buffer. */
 static inline SystemIoError Writer_write(
     Writer* writer, void const* data, size_t size
@@ -71,6 +99,14 @@ static inline SystemIoError Writer_write(
     return writer->write(writer, data, size);
 }
 
+/** Write out any buffered data. */
+static inline SystemIoError Writer_flush(Writer* writer) {
+    if (writer->flush == NULL) {
+        return SystemIoError_Success;
+    }
+    return writer->flush(writer);
+}
+
 /** Write formatted string. */
 SystemIoError Writer_format(Writer* writer, char const* format, ...);
 
@@ -3,6 +3,11 @@
 
 #include <stdlib.h>
 
+void exit_out_of_memory(void) {
+    Writer_format(Writer_stdout, "zeno-spec: error: out of memory\n");
+    exit(1);
+}
+
 void* xreallocarray(void* p, size_t n, size_t m) {
     size_t total;
 
@@ -16,8 +21,7 @@ void* xreallocarray(void* p, size_t n, size_t m) {
     p = realloc(p, total);
 
     if (p == NULL) {
-        Writer_format(Writer_stdout, "zeno-spec: error: out of memory\n");
-        exit(1);
+        exit_out_of_memory();
     }
 
     return p;
@@ -9,6 +9,9 @@
 #define xallocarray(n, m) xreallocarray(NULL, (n), (m))
 void* xreallocarray(void* p, size_t n, size_t m);
 
+/** Report that memory ran out and exit, as the x*alloc functions do. */
+void exit_out_of_memory(void);
+
 void* ensure_array_capacity(
     size_t item_size,
     void* data,
@@ -1,5 +1,6 @@
 #include "src/support/string_ref.h"
 #include "src/support/fnv1a.h"
+#include "src/support/wyhash.h"
 
 #include <string.h>
 
@@ -20,6 +21,10 @@ int StringRef_equal_zstr(StringRef left, char const* right) {
 }
 
 uint32_t StringRef_hash(StringRef string) {
+    return wyhash(string.data, string.size);
+}
+
+uint32_t StringRef_hash_fnv1a(StringRef string) {
     return fnv1a_add(fnv1a_start(), string.data, string.size);
 }
 
@@ -27,6 +32,10 @@ uint32_t StringRef_hash_generic(void const* key) {
     return StringRef_hash(*(StringRef const*)key);
 }
 
+uint32_t StringRef_hash_fnv1a_generic(void const* key) {
+    return StringRef_hash_fnv1a(*(StringRef const*)key);
+}
+
 int StringRef_equal_generic(void const* left, void const* right) {
     return StringRef_equal(
         *(StringRef const*)left,
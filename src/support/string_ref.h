@@ -23,11 +23,17 @@ typedef struct StringRef {
 StringRef StringRef_from_zstr(char const* s);
 
 int StringRef_equal(StringRef left, StringRef right);
+
+/** Hash with wyhash, reading a word at a time. */
 uint32_t StringRef_hash(StringRef string);
 
+/** Hash with FNV-1a, one byte at a time. Deterministic across platforms. */
+uint32_t StringRef_hash_fnv1a(StringRef string);
+
 int StringRef_equal_zstr(StringRef left, char const* right);
 
 uint32_t StringRef_hash_generic(void const* key);
+uint32_t StringRef_hash_fnv1a_generic(void const* key);
 int StringRef_equal_generic(void const* left, void const* right);
 
 #endif
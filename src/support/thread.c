@@ -0,0 +1,58 @@
+#include "src/support/thread.h"
+
+#if HAVE_THREADS
+
+static void* run_thread(void* arg) {
+    Thread* thread;
+    thread = arg;
+    thread->function(thread->arg);
+    return NULL;
+}
+
+void Thread_start(Thread* thread, ThreadFunction function, void* arg) {
+    thread->function = function;
+    thread->arg = arg;
+    thread->is_started =
+        pthread_create(&thread->handle, NULL, run_thread, thread) == 0;
+
+    if (!thread->is_started) {
+        /* Out of threads, so do the work now. */
+        function(arg);
+    }
+}
+
+void Thread_join(Thread* thread) {
+    if (thread->is_started) {
+        pthread_join(thread->handle, NULL);
+        thread->is_started = false;
+    }
+}
+
+unsigned Thread_cpu_count(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long count;
+    count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count > 1) {
+        return (unsigned)count;
+    }
+#endif
+    return 1;
+}
+
+#else
+
+void Thread_start(Thread* thread, ThreadFunction function, void* arg) {
+    thread->function = function;
+    thread->arg = arg;
+    function(arg);
+}
+
+void Thread_join(Thread* thread) {
+    (void)thread; /* unused */
+}
+
+unsigned Thread_cpu_count(void) {
+    return 1;
+}
+
+#endif
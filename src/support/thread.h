@@ -0,0 +1,37 @@
+#ifndef _ZENO_SPEC_SRC_SUPPORT_THREAD_H
+#define _ZENO_SPEC_SRC_SUPPORT_THREAD_H
+
+/*
+ * Minimal worker threads on top of POSIX threads. Without them, or with
+ * NO_THREADS defined, `Thread_start` runs the function on the calling thread
+ * before returning, so callers work the same either way.
+ */
+
+#include "src/support/defs.h"
+
+#if HAVE_POSIX_2001 && !defined(NO_THREADS)
+    #define HAVE_THREADS 1
+    #include <pthread.h>
+#endif
+
+typedef void (*ThreadFunction)(void* arg);
+
+typedef struct Thread {
+    ThreadFunction function;
+    void* arg;
+#if HAVE_THREADS
+    pthread_t handle;
+    int is_started;
+#endif
+} Thread;
+
+/** Run `function(arg)`, on a new thread if possible. */
+void Thread_start(Thread* thread, ThreadFunction function, void* arg);
+
+/** Wait for the function passed to `Thread_start` to return. */
+void Thread_join(Thread* thread);
+
+/** Number of processors available, at least 1. */
+unsigned Thread_cpu_count(void);
+
+#endif
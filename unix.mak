@@ -8,11 +8,14 @@ E =
 O = .o
 
 # C compiler options.
+# Add -DARENA_PER_ALLOCATION to CPPFLAGS to give every arena allocation its
+# own malloc block, for checking under AddressSanitizer.
+# To build without threads, add -DNO_THREADS to CPPFLAGS and clear LIBS.
 CC = cc
 CFLAGS = -g
 LDFLAGS =
 CPPFLAGS =
-LIBS =
+LIBS = -lpthread
 
 # Yacc options.
 YACC = byacc
@@ -54,6 +57,7 @@ lib_objects = \
 	src/support/io$(O) \
 	src/support/malloc$(O) \
 	src/support/string_ref$(O) \
+	src/support/thread$(O) \
 	src/parsing/token$(O)
 
 zeno_spec_objects = \
@@ -65,9 +69,46 @@ zeno_spec_exe = zeno-spec$(E)
 lex_fuzz_objects = $(lib_objects) src/parsing/lex_fuzz$(O)
 lex_fuzz_exe = lex_fuzz$(E)
 
-hash_map_test_objects = $(lib_objects) src/support/hash_map_test$(O)
+hash_map_test_objects = \
+	$(lib_objects) \
+	src/support/bench_input$(O) \
+	src/support/hash_map_test$(O)
 hash_map_test_exe = hash_map_test$(E)
 
+arena_test_objects = \
+	src/support/arena$(O) \
+	src/support/arena_test$(O) \
+	src/support/format$(O) \
+	src/support/io$(O) \
+	src/support/malloc$(O)
+arena_test_exe = arena_test$(E)
+
+# The same test with ARENA_PER_ALLOCATION.
+arena_per_allocation_test_objects = \
+	src/support/arena_per_allocation$(O) \
+	src/support/arena_per_allocation_test$(O) \
+	src/support/format$(O) \
+	src/support/io$(O) \
+	src/support/malloc$(O)
+arena_per_allocation_test_exe = arena_per_allocation_test$(E)
+
+bigint_test_objects = $(lib_objects) src/support/bigint_test$(O)
+bigint_test_exe = bigint_test$(E)
+
+lex_test_objects = $(lib_objects) src/parsing/lex_test$(O)
+lex_test_exe = lex_test$(E)
+
+type_checking_test_objects = \
+	$(lib_objects) \
+	src/sema/type_checking_test$(O)
+type_checking_test_exe = type_checking_test$(E)
+
+keyword_bench_objects = \
+	$(lib_objects) \
+	src/support/bench_input$(O) \
+	src/parsing/keyword_bench$(O)
+keyword_bench_exe = keyword_bench$(E)
+
 #
 # Top-level targets
 #
@@ -80,6 +121,15 @@ clean:
 	$(Q)rm -f $(zeno_spec_exe) src/driver/main$(O)
 	$(Q)rm -f $(lex_fuzz_exe) src/parsing/lex_fuzz$(O)
 	$(Q)rm -f $(hash_map_test_exe) src/support/hash_map_test$(O)
+	$(Q)rm -f $(arena_test_exe) src/support/arena_test$(O)
+	$(Q)rm -f $(arena_per_allocation_test_exe) \
+		src/support/arena_per_allocation$(O) \
+		src/support/arena_per_allocation_test$(O)
+	$(Q)rm -f $(bigint_test_exe) src/support/bigint_test$(O)
+	$(Q)rm -f $(lex_test_exe) src/parsing/lex_test$(O)
+	$(Q)rm -f $(type_checking_test_exe) src/sema/type_checking_test$(O)
+	$(Q)rm -f $(keyword_bench_exe) src/parsing/keyword_bench$(O)
+	$(Q)rm -f src/support/bench_input$(O)
 	$(Q)rm -f src/parsing/parse.output src/parsing/parse.tab.c
 
 -include src/ast/*.d
@@ -133,27 +183,73 @@ $(hash_map_test_exe): $(hash_map_test_objects)
 	$(Q)mkdir -p $(@D)
 	$(Q)$(CC) $(CFLAGS) $(LDFLAGS) -o $@ $(hash_map_test_objects) $(LIBS)
 
+$(arena_test_exe): $(arena_test_objects)
+	@echo "LD $@"
+	$(Q)mkdir -p $(@D)
+	$(Q)$(CC) $(CFLAGS) $(LDFLAGS) -o $@ $(arena_test_objects) $(LIBS)
+
+$(arena_per_allocation_test_exe): $(arena_per_allocation_test_objects)
+	@echo "LD $@"
+	$(Q)mkdir -p $(@D)
+	$(Q)$(CC) $(CFLAGS) $(LDFLAGS) -o $@ \
+		$(arena_per_allocation_test_objects) $(LIBS)
+
+src/support/arena_per_allocation$(O): src/support/arena.c
+	@echo "CC $@: $?"
+	$(Q)mkdir -p $(@D)
+	$(Q)$(CC) -c $(CFLAGS) $(CPPFLAGS) -DARENA_PER_ALLOCATION -I$(srcdir) -o $@ $?
+
+src/support/arena_per_allocation_test$(O): src/support/arena_test.c
+	@echo "CC $@: $?"
+	$(Q)mkdir -p $(@D)
+	$(Q)$(CC) -c $(CFLAGS) $(CPPFLAGS) -DARENA_PER_ALLOCATION -I$(srcdir) -o $@ $?
+
+$(bigint_test_exe): $(bigint_test_objects)
+	@echo "LD $@"
+	$(Q)mkdir -p $(@D)
+	$(Q)$(CC) $(CFLAGS) $(LDFLAGS) -o $@ $(bigint_test_objects) $(LIBS)
+
+$(lex_test_exe): $(lex_test_objects)
+	@echo "LD $@"
+	$(Q)mkdir -p $(@D)
+	$(Q)$(CC) $(CFLAGS) $(LDFLAGS) -o $@ $(lex_test_objects) $(LIBS)
+
+$(type_checking_test_exe): $(type_checking_test_objects)
+	@echo "LD $@"
+	$(Q)mkdir -p $(@D)
+	$(Q)$(CC) $(CFLAGS) $(LDFLAGS) -o $@ $(type_checking_test_objects) $(LIBS)
+
 #
 # Tests
 #
 
 # TODO: an actual test framework
-test: test-lex test-types test-hash-map
+test: test-lex test-parse test-types test-arena test-hash-map test-bigint
 
-test-lex: test-lex-valid test-lex-invalid
+test-lex: test-lex-valid test-lex-invalid test-lex-positions test-lex-parallel
 
 CHECK_LEX_VALID = $(Q)./$(zeno_spec_exe) tokenize --quiet -- $(srcdir)/tests/lex/valid
 CHECK_LEX_INVALID = $(Q)./$(zeno_spec_exe) tokenize --quiet --expect-failure -- $(srcdir)/tests/lex/invalid
+CHECK_TYPES_VALID = $(Q)./$(zeno_spec_exe) check --quiet $(srcdir)/tests/binding/valid
 CHECK_TYPES_INVALID = $(Q)./$(zeno_spec_exe) check --quiet --expect-failure $(srcdir)/tests/binding/invalid
 
 test-lex-valid: $(zeno_spec_exe)
 	@echo "TEST lex-valid"
 	$(CHECK_LEX_VALID)/bom.zn
+	$(CHECK_LEX_VALID)/comment_columns.zn
 	$(CHECK_LEX_VALID)/cr.zn
 	$(CHECK_LEX_VALID)/crlf.zn
 	$(CHECK_LEX_VALID)/tab.zn
 	$(CHECK_LEX_VALID)/tokens.zn
 
+# Token positions, including line breaks and tab stops in comments.
+test-lex-positions: $(zeno_spec_exe)
+	@echo "TEST lex-positions"
+	$(Q)for name in bom comment_columns cr crlf tab; do \
+		./$(zeno_spec_exe) tokenize -- $(srcdir)/tests/lex/valid/$$name.zn \
+		| diff -u $(srcdir)/tests/lex/valid/$$name.tokens - || exit 1; \
+	done
+
 test-lex-invalid: $(zeno_spec_exe)
 	@echo "TEST lex-invalid"
 	$(CHECK_LEX_INVALID)/bad_utf8.zn
@@ -173,14 +269,80 @@ test-lex-invalid: $(zeno_spec_exe)
 	$(CHECK_LEX_INVALID)/hex_literal_no_value.zn
 	$(CHECK_LEX_INVALID)/hex_literal_trailing_junk.zn
 	$(CHECK_LEX_INVALID)/hex_literal_trailing_underscore.zn
+	$(CHECK_LEX_INVALID)/overlong_utf8.zn
+	$(CHECK_LEX_INVALID)/overlong_utf8_4_byte.zn
 	$(CHECK_LEX_INVALID)/unclosed_block_comment.zn
 
-test-types: test-types-invalid
+# Chunked lexing against lexing the whole file, on a generated source.
+test-lex-parallel: $(lex_test_exe)
+	@echo "TEST lex-parallel"
+	$(Q)./$(lex_test_exe)
+
+# Which error wins when a file has both a syntax error and a lex error after
+# it. Invalid UTF-8 is found up front, other lex errors only once reached.
+test-parse: $(zeno_spec_exe)
+	@echo "TEST parse"
+	$(Q)./$(zeno_spec_exe) parse $(srcdir)/tests/parse/invalid/syntax_error_before_bad_utf8.zn 2>&1 \
+		| grep -q "invalid UTF-8 encoding"
+	$(Q)./$(zeno_spec_exe) parse $(srcdir)/tests/parse/invalid/syntax_error_before_bad_literal.zn 2>&1 \
+		| grep -q "expected item"
+
+test-types: test-types-valid test-types-invalid test-types-module
+
+# Parse, check, and compile files of several items.
+test-types-valid: $(zeno_spec_exe)
+	@echo "TEST types-valid"
+	$(Q)./$(zeno_spec_exe) parse --quiet $(srcdir)/tests/binding/valid/multi_item.zn
+	$(CHECK_TYPES_VALID)/multi_item.zn
+	$(Q)./$(zeno_spec_exe) compile $(srcdir)/tests/binding/valid/multi_item.zn \
+		| diff -u $(srcdir)/tests/binding/valid/multi_item.bytecode -
 
 test-types-invalid: $(zeno_spec_exe)
 	@echo "TEST types-invalid"
+	$(CHECK_TYPES_INVALID)/undeclared_name_in_later_item.zn
 	$(CHECK_TYPES_INVALID)/undefined_return_type.zn
 
+# Bodies checked on several threads, on a generated module.
+test-types-module: $(type_checking_test_exe)
+	@echo "TEST types-module"
+	$(Q)./$(type_checking_test_exe)
+
 test-hash-map: $(hash_map_test_exe)
 	@echo "TEST hash-map"
 	$(Q)./$(hash_map_test_exe)
+
+# Both arena builds: chunked, and one malloc block per allocation.
+test-arena: $(arena_test_exe) $(arena_per_allocation_test_exe)
+	@echo "TEST arena"
+	$(Q)./$(arena_test_exe)
+	$(Q)./$(arena_per_allocation_test_exe)
+
+test-bigint: $(bigint_test_exe)
+	@echo "TEST bigint"
+	$(Q)./$(bigint_test_exe)
+
+#
+# Benchmarks
+#
+
+bench: bench-hash-map bench-hash bench-keywords
+
+$(keyword_bench_exe): $(keyword_bench_objects)
+	@echo "LD $@"
+	$(Q)mkdir -p $(@D)
+	$(Q)$(CC) $(CFLAGS) $(LDFLAGS) -o $@ $(keyword_bench_objects) $(LIBS)
+
+bench-hash-map: $(hash_map_test_exe)
+	@echo "BENCH hash-map"
+	$(Q)./$(hash_map_test_exe) --bench
+
+# Identifiers in our own sources make a reasonable corpus.
+bench-hash: $(hash_map_test_exe)
+	@echo "BENCH hash"
+	$(Q)./$(hash_map_test_exe) --bench-hash \
+		$(srcdir)/src/*/*.c $(srcdir)/src/*/*.h $(srcdir)/src/parsing/parse.y
+
+bench-keywords: $(keyword_bench_exe)
+	@echo "BENCH keywords"
+	$(Q)./$(keyword_bench_exe) \
+		$(srcdir)/src/*/*.c $(srcdir)/src/*/*.h $(srcdir)/src/parsing/parse.y